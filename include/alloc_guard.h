@@ -0,0 +1,24 @@
+// Debug check that the steady-state paths do not touch the heap. In a build with ALLOC_GUARD
+// defined and malloc/calloc/realloc wrapped by the linker (env "allocguard" in platformio.ini),
+// every allocation a task makes while inside a NoAllocScope is counted against that scope and
+// the first offender's return address kept; allocGuardReport() logs them. Allocations outside
+// a scope are only counted per task. The hooks never log or allocate themselves. Without
+// ALLOC_GUARD a scope is empty and the report prints nothing.
+#pragma once
+
+#include <Arduino.h>
+
+class NoAllocScope {
+public:
+#ifdef ALLOC_GUARD
+  explicit NoAllocScope(const char* name);
+  ~NoAllocScope();
+#else
+  explicit NoAllocScope(const char* name) { (void)name; }
+#endif
+  NoAllocScope(const NoAllocScope&) = delete;
+  NoAllocScope& operator=(const NoAllocScope&) = delete;
+};
+
+// Logs violations since boot and per-task allocation counts. Call outside any scope.
+void allocGuardReport();
@@ -0,0 +1,70 @@
+// Per-hour, per-tag counts of the collections this terminal served, kept as the scans are
+// answered and uploaded as a few summary rows (collection_rollups: terminal, hour, tag,
+// served) next to the raw food_collections inserts, so reporting reads a few hundred rows
+// instead of every collection. Rows carry the absolute count and the server keeps the larger
+// of stored and sent, so a retried upload never counts twice. Serves answered before the clock
+// is trusted wait with their millis() stamp and are dated once it is, like the offline journal.
+// The table lives in NVS too (rate limited, and right after every accepted upload so the saved
+// counts never fall behind the server's), so a reset mid-hour does not restart the hour from
+// zero; undated serves are not kept across a reset.
+// Any task: a spinlock guards the table. Hours are UTC hours since the epoch.
+#pragma once
+
+#include <Arduino.h>
+#include "time_service.h"
+
+class CollectionRollup {
+public:
+  static const uint8_t kCells = 96;     // hour x tag counters; the oldest uploaded ones make room
+  static const uint8_t kUndated = 32;   // serves waiting for a trusted clock
+
+  struct Cell {
+    uint32_t hour;      // 0 = free
+    int16_t tag;        // -1: served offline before the staff (and tag) was known
+    uint16_t served;
+    uint16_t uploaded;  // `served` as last accepted by the server
+    uint16_t reserved;
+  };
+
+  explicit CollectionRollup(TimeService& clock) : clock_(clock) {}
+
+  // setup(): restores the counters saved in `nvsNamespace`.
+  void begin(const char* nvsNamespace, uint32_t saveMinIntervalMs);
+
+  // One served collection, scanned at millis() `scanMs`.
+  void note(int tag, uint32_t scanMs);
+
+  // networkTask: dates the serves that waited for the clock. Returns how many were dated.
+  uint8_t dateUndated();
+  // networkTask: up to `max` cells whose count the server has not seen yet.
+  uint8_t changed(Cell* out, uint8_t max) const;
+  // networkTask: the server accepted these cells (as returned by changed()).
+  void uploaded(const Cell* cells, uint8_t n);
+  // networkTask: writes the table to NVS if it changed, at most every saveMinIntervalMs, and
+  // on the next call after an upload was accepted.
+  void persistIfDue(uint32_t nowMs);
+
+  // Cells for hours >= fromHour, by hour then tag. Returns how many were copied.
+  uint8_t since(uint32_t fromHour, Cell* out, uint8_t max) const;
+  // Current UTC hour, 0 while the clock is untrusted.
+  uint32_t currentHour() const;
+  uint32_t dropped() const { return dropped_; }  // serves lost to a full table
+  uint8_t undated() const { return undatedCount_; }
+
+private:
+  struct Undated { uint32_t monoMs; int16_t tag; };
+
+  void addLocked(uint32_t hour, int tag);
+
+  TimeService& clock_;
+  const char* nvs_ = nullptr;
+  uint32_t saveMinIntervalMs_ = 0;
+  uint32_t lastSaveMs_ = 0;
+  bool dirty_ = false;
+  bool saveNow_ = false;
+  Cell cells_[kCells] = {};
+  Undated undated_[kUndated] = {};
+  uint8_t undatedCount_ = 0;
+  uint32_t dropped_ = 0;
+  mutable portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
@@ -0,0 +1,60 @@
+// Fixed-size table of per-control-row state, keyed by the row's 16-byte UUID.
+// Open addressing with linear probing; entries carry an expiry and are reclaimed lazily on
+// insert and in bulk by sweep(). No heap use after construction. Not thread safe — callers
+// hold sharedMutex.
+#pragma once
+
+#include <Arduino.h>
+
+struct ControlUuid {
+  uint8_t b[16];
+};
+
+bool parseControlUuid(const char* s, ControlUuid& out);   // "xxxxxxxx-xxxx-..." (dashes optional)
+String controlUuidToString(const ControlUuid& id);
+bool controlUuidIsNil(const ControlUuid& id);
+inline bool operator==(const ControlUuid& a, const ControlUuid& b) { return memcmp(a.b, b.b, 16) == 0; }
+inline bool operator!=(const ControlUuid& a, const ControlUuid& b) { return !(a == b); }
+extern const ControlUuid kNilControlUuid;
+
+class ControlStateTable {
+public:
+  static const size_t kCapacity = 64; // power of two
+
+  // Row must not be offered again before `now + delayMs`.
+  void defer(const ControlUuid& id, unsigned long now, unsigned long delayMs);
+  bool isDeferred(const ControlUuid& id, unsigned long now) const;
+
+  // Template stored on the sensor, server commit still pending. Expires after ttlMs so a row
+  // the server never marked processed is eventually offered again.
+  void markAwaitingAck(const ControlUuid& id, unsigned long now, unsigned long ttlMs);
+  bool isAwaitingAck(const ControlUuid& id, unsigned long now) const;
+  // Clears the awaiting flag; returns how long the ACK took (0 if it was not awaiting).
+  unsigned long ackReceived(const ControlUuid& id, unsigned long now);
+  size_t awaitingCount(unsigned long now) const;
+
+  // Drops expired entries and tombstones. Cheap enough to run every few seconds.
+  void sweep(unsigned long now);
+  size_t size() const { return used_; }
+  unsigned long evictions() const { return evictions_; }
+
+private:
+  enum SlotState : uint8_t { SLOT_EMPTY = 0, SLOT_USED, SLOT_DELETED };
+  struct Slot {
+    ControlUuid id;
+    uint32_t deferUntil;   // millis(); 0 = not deferred
+    uint32_t ackSince;     // millis() stored on sensor; 0 = not awaiting
+    uint32_t expiresAt;    // millis() after which the slot may be reclaimed
+    uint8_t state;
+  };
+
+  static size_t hashOf(const ControlUuid& id);
+  static bool expired(const Slot& s, unsigned long now) { return (int32_t)(s.expiresAt - (uint32_t)now) <= 0; }
+  const Slot* find(const ControlUuid& id, unsigned long now) const;
+  Slot* findOrInsert(const ControlUuid& id, unsigned long now);
+  void refreshExpiry(Slot& s);
+
+  Slot slots_[kCapacity] = {};
+  size_t used_ = 0;
+  unsigned long evictions_ = 0;
+};
@@ -0,0 +1,112 @@
+// Display messages ("instr|HH:MM[|lane]") over pluggable transports with failover. Every line
+// goes out on the active transport and is tracked until the transport confirms it (ESP-NOW
+// send callback, or an "ack#<seq>" line from a display that echoes them) or the confirmation
+// times out. After a run of failures the link fails over to the other transport and re-sends
+// the newest line there, so the screen never lags a scan; the primary is retried after a
+// while. Transports that cannot confirm count a line as delivered once it is written.
+// send() may be called from any task; poll() from the main thread.
+#pragma once
+
+#include <Arduino.h>
+
+class DisplayTransport {
+public:
+  virtual ~DisplayTransport() {}
+  virtual const char* name() const = 0;
+  virtual bool begin() = 0;
+  // Hands one line to the medium; false if it could not even be queued.
+  virtual bool send(const char* line, size_t len, uint16_t seq) = 0;
+  // Next delivery result, if any: seq 0 = "the oldest line in flight" (in-order media).
+  virtual bool pollResult(uint16_t& seq, bool& ok) { (void)seq; (void)ok; return false; }
+  virtual bool confirms() const { return false; }
+};
+
+// Newline-terminated lines on a UART. With acks, each line carries "#<seq>" and the display
+// answers "ack#<seq>". A frame goes out as one write under lock_, so lines sent from two
+// tasks never interleave on the wire.
+class UartTransport : public DisplayTransport {
+public:
+  UartTransport(HardwareSerial& port, bool acks)
+      : port_(port), acks_(acks), lock_(xSemaphoreCreateMutexStatic(&lockBuf_)) {}
+  const char* name() const override { return "uart"; }
+  bool begin() override { return true; }
+  bool send(const char* line, size_t len, uint16_t seq) override;
+  bool pollResult(uint16_t& seq, bool& ok) override;
+  bool confirms() const override { return acks_; }
+
+private:
+  HardwareSerial& port_;
+  bool acks_;
+  StaticSemaphore_t lockBuf_;
+  SemaphoreHandle_t lock_;
+  char rx_[16];
+  size_t rxLen_ = 0;
+};
+
+// Unicast ESP-NOW to the display's MAC; the MAC-layer ACK drives the send callback. Needs
+// WiFi in STA mode first, and the display on the AP's channel. One instance per firmware.
+class EspNowTransport : public DisplayTransport {
+public:
+  explicit EspNowTransport(const uint8_t* peer) : peer_(peer) {}
+  const char* name() const override { return "espnow"; }
+  bool begin() override;
+  bool send(const char* line, size_t len, uint16_t seq) override;
+  bool pollResult(uint16_t& seq, bool& ok) override;
+  bool confirms() const override { return true; }
+
+private:
+  const uint8_t* peer_;
+  bool ready_ = false;
+};
+
+class DisplayLink {
+public:
+  static const uint8_t kMaxTransports = 2;
+  static const uint8_t kInFlight = 8;
+  static const size_t kMaxLine = 48;
+
+  struct Stats { uint32_t sent, delivered, failed, unconfirmed, totalMs, maxMs; };
+
+  // primary first; secondary may be null.
+  DisplayLink(DisplayTransport* primary, DisplayTransport* secondary);
+  void configure(unsigned long ackTimeoutMs, uint8_t failoverAfter, unsigned long failbackMs);
+  void begin();
+
+  void send(const char* line);
+  // Collects confirmations, times out the rest and decides failover. Main thread.
+  void poll(unsigned long now);
+
+  uint8_t transportCount() const { return count_; }
+  const DisplayTransport* transport(uint8_t i) const { return t_[i]; }
+  const Stats& stats(uint8_t i) const { return stats_[i]; }
+  uint8_t active() const { return active_; }
+  uint32_t failovers() const { return failovers_; }
+
+private:
+  struct Flight { uint16_t seq; uint8_t transport; bool used; unsigned long sentAt; };
+
+  void sendOn(uint8_t t, const char* line, unsigned long now, bool resend);
+  void settle(uint8_t slot, bool ok, unsigned long now);
+  void switchTo(uint8_t t, unsigned long now, const char* why);
+
+  DisplayTransport* t_[kMaxTransports];
+  bool up_[kMaxTransports] = {};
+  uint8_t count_ = 0;
+  uint8_t active_ = 0;
+  Stats stats_[kMaxTransports] = {};
+  uint8_t failRun_[kMaxTransports] = {};
+  uint8_t okRun_ = 0;           // primary confirmations in a row while on the fallback
+  Flight flight_[kInFlight] = {};
+  uint16_t seq_ = 0;
+  char last_[kMaxLine] = {};
+  uint16_t lastSeq_ = 0;
+  bool lastIsResend_ = false;
+  bool resendLast_ = false;
+  const char* switchReason_ = nullptr; // logged by poll()
+  unsigned long switchedAt_ = 0;
+  uint32_t failovers_ = 0;
+  unsigned long ackTimeoutMs_ = 150;
+  uint8_t failoverAfter_ = 3;
+  unsigned long failbackMs_ = 60000;
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
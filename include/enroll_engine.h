@@ -0,0 +1,91 @@
+// Non-blocking enrollment on one sensor, driven by a phase table instead of hand-written
+// per-step code: each phase names the sensor command it issues, how often it may issue it and
+// how long the phase may last before it ends the enrollment (timeout for the finger waits,
+// failure for the command round trips). Commands go out as raw frames (zfm_frame.h) and their
+// ACKs are collected on later poll() calls, so a waiting enrollment costs one GenImg per poll
+// interval (counted from the previous reply, so the sensor's own capture time is not part of
+// it) instead of a blocking getImage() on every loop() pass.
+//
+// Captures: 2, extracted into CharBuffer1 and CharBuffer2 and merged once with RegModel, as the
+// ZFM protocol defines it. With extra merges allowed (3 or 4 captures), each later capture goes
+// into CharBuffer2 and RegModel runs again against the merged template in CharBuffer1. The
+// protocol does not define RegModel on a merged template, so that stays off unless the sensor
+// model in use was verified to refine templates that way. If an extra capture does not extract
+// or merge, the template built so far is stored as is.
+//
+// Main thread only; the caller owns the sensor port while active() (the capture lane on the
+// same port is paused and idle).
+#pragma once
+
+#include <Arduino.h>
+#include "zfm_frame.h"
+
+class EnrollEngine {
+public:
+  enum Result { RESULT_STORED, RESULT_TIMEOUT, RESULT_FAILED };
+  // Prompts for the UI; the end of an enrollment is reported through the DoneFn.
+  enum Event { EV_NONE, EV_CAPTURED, EV_LIFTED, EV_DONE };
+  typedef void (*DoneFn)(Result result, int staffid, int fid);
+
+  static const uint8_t kMinCaptures = 2;
+  static const uint8_t kMaxCaptures = 4;
+
+  explicit EnrollEngine(Stream& port) : port_(port) {}
+
+  // pollMs paces GenImg while waiting for a finger / its removal; scanTimeoutMs bounds each
+  // of those waits.
+  void begin(uint32_t addr, unsigned long pollMs, unsigned long scanTimeoutMs, DoneFn done);
+  // Lets start() take 3 or 4 captures (RegModel on a merged template, see above).
+  void allowExtraMerges(bool allow) { extraMerges_ = allow; }
+
+  // `captures` is clamped to 2, or to 2..4 with extra merges allowed.
+  bool start(int staffid, uint16_t fid, uint8_t captures, unsigned long now);
+  // Advances by at most one sensor command; cheap when nothing is due.
+  Event poll(unsigned long now);
+  bool active() const { return phase_ != PH_IDLE; }
+
+  int staffid() const { return staffid_; }
+  int fid() const { return fid_; }
+  uint8_t captured() const { return captured_; }
+  uint8_t lastError() const { return lastError_; }
+
+  // Per enrollment (reset by start()), for the completion log
+  uint32_t commands() const { return commands_; }
+  uint32_t polls() const { return polls_; }
+  unsigned long elapsed(unsigned long now) const { return now - startedAt_; }
+
+private:
+  enum Phase { PH_IDLE, PH_WAIT_FINGER, PH_EXTRACT, PH_MERGE, PH_WAIT_LIFT, PH_STORE, PH_COUNT };
+  struct PhaseSpec {
+    uint8_t cmd;              // sensor instruction code
+    unsigned long pollMs;     // minimum gap between a reply and the next command of this phase
+    unsigned long deadlineMs; // phase budget, from entry; checked between commands
+    Result onDeadline;
+  };
+
+  void enter(Phase phase, unsigned long now);
+  void send(unsigned long now);
+  Event finish(Result result);
+  Event onAck(uint8_t code, unsigned long now);
+
+  Stream& port_;
+  uint32_t addr_ = 0xFFFFFFFF;
+  DoneFn done_ = nullptr;
+  PhaseSpec table_[PH_COUNT];
+  ZfmParser parser_;
+
+  Phase phase_ = PH_IDLE;
+  bool inFlight_ = false;
+  unsigned long phaseAt_ = 0;
+  unsigned long sentAt_ = 0;
+  unsigned long answeredAt_ = 0;
+  unsigned long startedAt_ = 0;
+  int staffid_ = -1;
+  int fid_ = -1;
+  bool extraMerges_ = false;
+  uint8_t target_ = kMinCaptures;
+  uint8_t captured_ = 0;
+  uint8_t lastError_ = 0;
+  uint32_t commands_ = 0;
+  uint32_t polls_ = 0;
+};
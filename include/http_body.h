@@ -0,0 +1,84 @@
+// Response body as a Stream for deserializeJson, inflating gzip/deflate on the fly. The inflater
+// works out of one 32 KB window (deflate's largest back-reference, so any server's stream
+// decodes) plus its Huffman tables, allocated only while a compressed body is read; the JSON
+// itself is never held compressed or whole. request() only asks for compression when that
+// much heap is free in one block. Bodies are read from the connection as they arrive and the
+// request stays HTTP/1.1: chunked framing is removed here, and a body ends at its
+// Content-Length or last chunk rather than at the server's close, so drain() can leave the
+// connection ready for the next request on it (the fingerprint map's pages share one).
+#pragma once
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+
+class HttpBody : public Stream {
+public:
+  enum Encoding : uint8_t { IDENTITY, GZIP, DEFLATE, UNSUPPORTED };
+
+  static const size_t kInflateBytes;       // heap held while inflating
+  static const uint32_t kReadTimeoutMs = 5000;
+
+  // Before GET. Also collects Content-Encoding, Transfer-Encoding plus `extraHeader` (e.g.
+  // "ETag") from the reply.
+  static void request(HTTPClient& h, bool allowCompressed, const char* extraHeader = nullptr);
+
+  // After a 200: reads h's connection.
+  explicit HttpBody(HTTPClient& h);
+  // The body on `src` given the reply's headers; contentLength -1 = not sent.
+  HttpBody(Client& src, const String& contentEncoding, const String& transferEncoding, int contentLength);
+  ~HttpBody();
+  HttpBody(const HttpBody&) = delete;
+  HttpBody& operator=(const HttpBody&) = delete;
+
+  // False for an unknown encoding, no memory for the inflater, or a corrupt stream; the JSON
+  // parse fails then too, this says why.
+  bool ok() const { return !failed_; }
+  Encoding encoding() const { return encoding_; }
+  static const char* encodingName(Encoding e);
+  uint32_t wireBytes() const { return wire_; }   // body bytes received, chunk framing included
+  uint32_t bodyBytes() const { return body_; }   // after inflating, as handed to the parser
+
+  // Reads what the parser left of the body (gzip trailer, last chunk) so the connection can
+  // carry the next request; call before h.end(). A body that cannot be read to its end
+  // (corrupt, timed out, no length) closes the connection instead, so the next request
+  // reconnects rather than reading leftovers. False in that case.
+  bool drain();
+
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t) override { return 0; }
+
+private:
+  struct Inflater;
+
+  int rawByte();
+  bool waitForSource();
+  int srcByte();
+  bool nextChunk();
+  bool refillInput();
+  bool skipGzipHeader();
+  bool inflateMore();
+
+  Client& src_;
+  Encoding encoding_ = IDENTITY;
+  bool failed_ = false;
+  Inflater* z_ = nullptr;
+  uint8_t in_[256];
+  size_t inPos_ = 0, inLen_ = 0;
+  bool srcEnd_ = false;
+  bool chunked_ = false;
+  bool firstChunk_ = true;
+  int32_t left_ = -1;              // bytes left in the body or current chunk, -1 = until close
+  const uint8_t* out_ = nullptr;   // inflated bytes not yet read
+  size_t outLen_ = 0, outPos_ = 0;
+  uint32_t wire_ = 0, body_ = 0;
+};
+
+// Per-resource download totals for the hourly log. networkTask only.
+struct BodyStats {
+  uint32_t bodies = 0, compressed = 0;
+  uint32_t wireBytes = 0, jsonBytes = 0;
+  uint32_t totalMs = 0;
+  void note(const HttpBody& b, uint32_t ms);
+};
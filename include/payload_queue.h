@@ -0,0 +1,39 @@
+// Upload queue of JSON payloads (collections, deferred ops) in fixed slots, so queueing a scan
+// never touches the heap. A payload is pending from push() until done(): an identical push is
+// refused as a duplicate the whole time, including while the network task has it out for
+// upload. take() hands out the oldest queued payload, requeue() puts it at the back after a
+// failed attempt. Not thread safe — callers hold sharedMutex.
+#pragma once
+
+#include <Arduino.h>
+
+class PayloadQueue {
+public:
+  static const uint8_t kSlots = 48;
+  static const size_t kMaxLen = 240; // including the terminator
+
+  enum PushResult { PUSHED, DUPLICATE, FULL, TOO_LONG };
+
+  PushResult push(const char* payload);
+  bool contains(const char* payload) const;
+
+  // Copies the oldest queued payload into `out` and returns its slot, or -1 if none is queued.
+  // The slot stays pending until requeue() or done().
+  int take(char* out, size_t cap);
+  void requeue(int slot);
+  void done(int slot);
+  // New content for a taken slot (back-filled timestamp); false if it does not fit.
+  bool replace(int slot, const char* payload);
+
+  size_t queued() const;
+  size_t pending() const;
+  uint32_t overflows() const { return overflows_; }
+
+private:
+  enum SlotState : uint8_t { SLOT_FREE = 0, SLOT_QUEUED, SLOT_TAKEN };
+  struct Slot { uint8_t state; uint16_t len; uint32_t order; char text[kMaxLen]; };
+
+  Slot slots_[kSlots] = {};
+  uint32_t nextOrder_ = 0;
+  uint32_t overflows_ = 0;
+};
@@ -0,0 +1,37 @@
+// Skips cache refreshes whose server data did not change. Two validators, whichever the server
+// offers: a token (row count + newest change, from the sync_tokens RPC) compared before any
+// download, and an HTTP ETag sent back as If-None-Match, where a 304 ends the refresh. Both are
+// only remembered once the refresh that saw them finished (commit()), so a failed rebuild is
+// retried in full. invalidate() forces the next refresh to download. networkTask only.
+#pragma once
+
+#include <Arduino.h>
+#include <HTTPClient.h>
+
+class RefreshValidator {
+public:
+  explicit RefreshValidator(const char* name) : name_(name) {}
+
+  // Start of a refresh. True when `token` (empty = unknown) matches the last committed one,
+  // i.e. the refresh is avoided.
+  bool unchanged(const String& token);
+  // Before GET: sends If-None-Match. The caller has h collect the "ETag" header.
+  void prepare(HTTPClient& h);
+  // After GET: true on 304 (refresh avoided); otherwise keeps the reply's ETag for commit().
+  bool notModified(HTTPClient& h, int code);
+  // The refresh rebuilt the cache; remember what it was validated with.
+  void commit();
+  void invalidate();
+
+  const char* name() const { return name_; }
+  uint32_t refreshes() const { return refreshes_; }
+  uint32_t avoided() const { return avoided_; }
+  float avoidedPercent() const { return refreshes_ ? 100.0f * avoided_ / refreshes_ : 0.0f; }
+
+private:
+  const char* name_;
+  String token_, etag_;               // committed
+  String pendingToken_, pendingEtag_; // seen by the refresh in progress
+  uint32_t refreshes_ = 0;
+  uint32_t avoided_ = 0;
+};
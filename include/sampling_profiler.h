@@ -0,0 +1,57 @@
+// Sampling CPU profiler for field terminals. A hardware timer interrupt on each core records
+// the task it interrupted and the 64-byte code bucket holding the PC into that core's fixed
+// histogram (open addressing on the bucket); nothing else runs per sample. Buckets rather than
+// exact PCs keep the hot set of a rush to a few hundred bins, so the table does not fill in
+// seconds and drop the samples of whatever code runs after that. The tables
+// are allocated at the first start, so a terminal that is never profiled pays no RAM. The PC
+// is read from the exception frame the interrupt saved on the task's stack: samples that land
+// in another interrupt are counted as "isr" without a PC, time inside a critical section is
+// charged to the first instruction after it (the timer interrupt is masked there), and while a
+// flash write has the cache off no samples are taken at all.
+// dump() writes "PROF ..." lines; scripts/symbolize_profile.py maps the PCs to functions with
+// addr2line and the firmware ELF of the same build.
+#pragma once
+
+#include <Arduino.h>
+
+class SamplingProfiler {
+public:
+  static const uint16_t kPcBins = 512;   // per core, distinct code buckets
+  static const uint8_t kPcBucketBits = 6; // 64-byte buckets
+  static const uint8_t kTaskBins = 16;   // per core
+  static const uint8_t kProbes = 8;      // a bucket not placed within this many bins is dropped
+
+  // Main thread. Clears the tables and (re)starts sampling both cores at `hz` per core. False
+  // when the tables or timers could not be had.
+  bool start(uint32_t hz);
+  void stop();
+  bool running() const { return running_; }
+
+  // Main thread, stops sampling first. Writes up to `maxLines` lines per call so the dump can be
+  // spread over several loop() passes; true while there is more to write.
+  bool dump(Print& out, uint16_t maxLines);
+
+  // Timer interrupt of `core`.
+  void sample(uint8_t core);
+
+private:
+  struct PcBin { uint32_t pc; uint32_t count; }; // pc: first address of the bucket
+  struct TaskBin { TaskHandle_t handle; uint32_t count; char name[16]; };
+  struct Core {
+    PcBin pcs[kPcBins];
+    TaskBin tasks[kTaskBins];
+    uint32_t samples, inIsr, dropped, otherTasks;
+    uint64_t isrCycles;          // spent in sample(), for the overhead figure
+  };
+
+  static void attachTimer(void* self); // on the core it samples, via esp_ipc
+
+  Core* cores_ = nullptr;
+  hw_timer_t* timers_[2] = {};
+  uint32_t hz_ = 0;
+  uint32_t startMs_ = 0, elapsedMs_ = 0;
+  volatile bool running_ = false;
+  // dump cursor: 0 = header, then tasks and PCs of core 0, core 1, then the end line
+  uint32_t dumpPos_ = 0;
+  bool dumping_ = false;
+};
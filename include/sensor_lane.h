@@ -0,0 +1,124 @@
+// One fingerprint sensor driven as a non-blocking capture pipeline: GenImg -> Img2Tz ->
+// HiSpeedSearch, each step a command frame written to the sensor's UART whose ACK is picked
+// up on a later poll(). With one lane per UART, the serial round trips and sensor processing
+// of all lanes overlap instead of queueing behind one blocking Adafruit call.
+// A scan session does not end at the first search: see MatchPolicy. With a hot range set, the
+// fast search runs over the low slots (frequent diners) first and over the rest second.
+// Main thread only. Adafruit_Fingerprint can still be used on a lane's port (enrollment,
+// template transfer) while the lane is paused and idle().
+#pragma once
+
+#include <Arduino.h>
+#include "zfm_frame.h"
+
+class SensorLane {
+public:
+  enum Event { EV_NONE, EV_FINGER, EV_MATCH, EV_NO_MATCH, EV_ERROR };
+
+  // A hit scoring below acceptScore re-captures at once (the finger is normally still on the
+  // glass) up to maxRecaptures times, keeping the best hit; when the tries run out or the
+  // finger is lifted, the best hit is accepted if it reaches minScore (0 = the sensor's own
+  // verdict). A HiSpeedSearch miss is repeated with the exhaustive Search before it is
+  // reported, if fullSearchOnMiss.
+  struct MatchPolicy {
+    uint16_t acceptScore;
+    uint16_t minScore;
+    uint8_t maxRecaptures;
+    bool fullSearchOnMiss;
+  };
+
+  // How a scan session ended, for tuning the policy
+  enum Outcome {
+    OUT_MATCH,             // first capture, fast search
+    OUT_MATCH_RECAPTURE,   // best hit came from a re-capture
+    OUT_MATCH_FULL_SEARCH, // best hit came from the exhaustive search
+    OUT_LOW_SCORE,         // hits, none reaching minScore
+    OUT_MISS,              // no hit at all
+    OUT_ERROR,
+    OUT_COUNT
+  };
+  struct OutcomeStats { uint32_t count; uint32_t totalMs; uint32_t maxMs; }; // finger -> outcome
+
+  enum SearchStage { SEARCH_HOT, SEARCH_COLD, SEARCH_FULL, SEARCH_STAGES };
+  struct SearchStats { uint32_t count; uint32_t hits; uint32_t totalMs; }; // per search command
+  static const char* outcomeName(Outcome o);
+
+  SensorLane(uint8_t id, Stream& port) : id_(id), port_(port) {}
+
+  // addr / capacity from the sensor's system parameters; pollGapMs paces GenImg while no
+  // finger is present.
+  void begin(uint32_t addr, uint16_t capacity, unsigned long pollGapMs);
+  void setPolicy(const MatchPolicy& policy) { policy_ = policy; }
+  // Slots 1..hotSlots are searched first; 0 = one search over the whole library.
+  void setHotRange(uint16_t hotSlots) { hotSlots_ = hotSlots; }
+
+  // Advances the pipeline by at most one step and returns what happened.
+  Event poll(unsigned long now);
+
+  // Paused lanes finish the command in flight and then stay idle.
+  void setPaused(bool paused) { paused_ = paused; }
+  bool idle() const { return step_ == ST_IDLE; }
+  // No new capture before `until` (result on screen, cool-down).
+  void holdUntil(unsigned long until) { holdUntil_ = until; }
+
+  uint8_t id() const { return id_; }
+  uint16_t fid() const { return fid_; }
+  uint16_t score() const { return score_; }
+  uint8_t lastError() const { return lastError_; }
+  Outcome lastOutcome() const { return lastOutcome_; }
+  unsigned long fingerAt() const { return fingerAt_; } // millis() the last session's finger landed
+  // The event the last poll() returned ended a scan session. An EV_ERROR outside a session
+  // (idle GetImage error, ACK timeout) does not, and fingerAt() is stale then.
+  bool sessionEnded() const { return sessionEnded_; }
+
+  // Counters for the throughput log
+  uint32_t captures() const { return captures_; }
+  uint32_t commands() const { return commands_; }
+  uint32_t recaptures() const { return recaptures_; }
+  const OutcomeStats& stats(Outcome o) const { return stats_[o]; }
+  const SearchStats& searchStats(SearchStage st) const { return searchStats_[st]; }
+
+private:
+  enum Step { ST_IDLE, ST_GETIMAGE, ST_IMG2TZ, ST_SEARCH };
+  void send(Step step, const uint8_t* cmd, size_t len, unsigned long now);
+  void sendGenImg(unsigned long now);
+  void sendSearch(SearchStage stage, unsigned long now);
+  Event fail(uint8_t code, unsigned long now);
+  Event onHit(uint16_t fid, uint16_t score, bool full, unsigned long now);
+  Event settle(unsigned long now);
+  Event resolve(Outcome o, unsigned long now);
+
+  uint8_t id_;
+  Stream& port_;
+  uint32_t addr_ = 0xFFFFFFFF;
+  uint16_t capacity_ = 127;
+  uint16_t hotSlots_ = 0;
+  SearchStage stage_ = SEARCH_HOT;
+  unsigned long pollGapMs_ = 80;
+  ZfmParser parser_;
+  Step step_ = ST_IDLE;
+  bool paused_ = false;
+  unsigned long sentAt_ = 0;
+  unsigned long lastGenImg_ = 0;
+  unsigned long holdUntil_ = 0;
+  uint16_t fid_ = 0;
+  uint16_t score_ = 0;
+  uint8_t lastError_ = 0;
+  uint32_t captures_ = 0;
+  uint32_t commands_ = 0;
+
+  MatchPolicy policy_ = { 0, 0, 0, false };
+  // current scan session (finger detected .. outcome)
+  bool inSession_ = false;
+  bool sessionEnded_ = false;
+  unsigned long fingerAt_ = 0;
+  uint8_t recaptured_ = 0;
+  bool haveBest_ = false;
+  uint16_t bestFid_ = 0;
+  uint16_t bestScore_ = 0;
+  Outcome bestVia_ = OUT_MATCH;
+  Outcome lastOutcome_ = OUT_MISS;
+  uint32_t recaptures_ = 0;
+  OutcomeStats stats_[OUT_COUNT] = {};
+  SearchStats searchStats_[SEARCH_STAGES] = {};
+};
@@ -0,0 +1,63 @@
+// Served-today events between the terminals of one canteen, carried over UDP multicast so a
+// diner who walks to the next line is refused there before the server has heard of the first
+// serve. Supabase stays authoritative: the periodic collectedToday refresh still runs, and
+// events received here are merged back into it until the server list catches up.
+//
+// Packet (little endian): magic "SG" | u8 version | u8 count | u32 terminal | u32 boot |
+// u32 dayKey | u32 lastSeq | count * u32 staffid. The staffids are the sender's events
+// lastSeq-count+1 .. lastSeq, so every packet repeats the last kWindow events and a lost
+// packet is covered by the next one; each burst is also re-sent on a short schedule. A
+// receiver tracks the highest sequence seen per (terminal, boot) and counts gaps it could not
+// fill. Transport-free: the caller moves the bytes. Not thread safe — callers hold
+// sharedMutex.
+#pragma once
+
+#include <Arduino.h>
+#include <vector>
+
+class ServedGossip {
+public:
+  static const uint8_t kWindow = 8;
+  static const size_t kHeaderLen = 2 + 1 + 1 + 4 + 4 + 4 + 4;
+  static const size_t kMaxPacket = kHeaderLen + kWindow * 4;
+  static const uint8_t kMaxPeers = 16;
+
+  struct Stats { uint32_t sent, received, applied, duplicates, gaps, ignored; };
+
+  void begin(uint32_t terminalId, uint32_t bootId) { terminal_ = terminalId; boot_ = bootId; }
+
+  // A serve on this terminal; goes out with the next pollSend().
+  void noteLocal(uint32_t dayKey, int staffid, unsigned long now);
+  // Fills `buf` when a packet is due (new events or a scheduled repeat); returns its length, or 0.
+  size_t pollSend(unsigned long now, uint8_t* buf, size_t cap);
+  // Applies a received packet for `dayKey`; appends staffids this terminal had not heard of
+  // from that peer to `fresh`. Own packets, other days and garbage are ignored.
+  bool receive(const uint8_t* buf, size_t len, uint32_t dayKey, std::vector<int>& fresh);
+
+  // Staffids received today, to re-add after the served-today list is replaced by the server's.
+  const std::vector<int>& remoteToday() const { return remote_; }
+  // Keeps room for `n` more remote serves so receive() does not allocate; call off the scan path.
+  void reserveRemote(size_t n) {
+    if (remote_.capacity() - remote_.size() < n) remote_.reserve(remote_.size() + 2 * n);
+  }
+  // New day: drops the remote list and the unsent window.
+  void resetDay(uint32_t dayKey);
+
+  const Stats& stats() const { return stats_; }
+
+private:
+  struct Peer { uint32_t terminal; uint32_t boot; uint32_t lastSeq; uint32_t lastRx; };
+
+  uint32_t terminal_ = 0;
+  uint32_t boot_ = 0;
+  uint32_t day_ = 0;
+  uint32_t seq_ = 0;
+  int window_[kWindow] = {};
+  uint8_t windowCount_ = 0;
+  uint8_t repeatsLeft_ = 0;
+  unsigned long nextSend_ = 0;
+  Peer peers_[kMaxPeers] = {};
+  uint8_t peerCount_ = 0;
+  std::vector<int> remote_;
+  Stats stats_ = {};
+};
@@ -0,0 +1,120 @@
+// Fingerprint id -> staff lookup for sites with tens of thousands of staff. StaffDirectory is
+// immutable and compact: records sorted by fid, cut into blocks of kBlock, each block stored
+// as a frame of reference (varint header: count, bit widths, zigzag staffid/tag minimums)
+// followed by one bit-packed stream of fid deltas, staffid and tag offsets. A sparse index
+// (first fid, segment, offset per block) is binary searched, then one block is walked. Blocks
+// live in kSegmentBytes heap segments, so a large directory needs no large contiguous block.
+// A directory is built once per sync with StaffDirectoryBuilder from fid-ordered records.
+// StaffMap layers the few changes made between syncs (enrollments, slot aliases, moves) over
+// the current directory. Not thread safe — callers hold sharedMutex.
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+struct StaffRecord { int staffid; int tag; };
+
+class StaffDirectory {
+public:
+  static const uint8_t kBlock = 32;
+  static const size_t kSegmentBytes = 8192;
+  static const size_t kMaxBlockBytes = 4 + 2 * 5 + (31 * 32 + 2 * 32 * 32 + 7) / 8;
+
+  StaffDirectory() {}
+  StaffDirectory(StaffDirectory&&) = default;
+  StaffDirectory& operator=(StaffDirectory&&) = default;
+
+  bool find(uint32_t fid, StaffRecord& out) const;
+  size_t size() const { return count_; }
+  // Heap held: segments plus index.
+  size_t bytes() const { return segments_.size() * kSegmentBytes + index_.capacity() * sizeof(IndexEntry); }
+  // Encoded record bytes only (what the format costs, without segment slack).
+  size_t encodedBytes() const { return encoded_; }
+  void clear();
+
+  // Calls f(fid, record) in ascending fid order.
+  template <class F> void forEach(F f) const {
+    uint32_t fids[kBlock];
+    StaffRecord recs[kBlock];
+    for (size_t b = 0; b < index_.size(); b++) {
+      uint8_t n = decodeBlock(b, fids, recs);
+      for (uint8_t i = 0; i < n; i++) f(fids[i], recs[i]);
+    }
+  }
+
+private:
+  friend class StaffDirectoryBuilder;
+  struct IndexEntry { uint32_t firstFid; uint16_t segment; uint16_t offset; };
+
+  uint8_t decodeBlock(size_t block, uint32_t* fids, StaffRecord* recs) const;
+
+  std::vector<IndexEntry> index_;
+  std::vector<std::unique_ptr<uint8_t[]>> segments_;
+  size_t segmentUsed_ = 0; // bytes used in the last segment
+  size_t count_ = 0;
+  size_t encoded_ = 0;
+};
+
+class StaffDirectoryBuilder {
+public:
+  // `expected` (records) only sizes the index up front.
+  explicit StaffDirectoryBuilder(size_t expected = 0);
+
+  // Records in ascending fid order; a repeated fid replaces the previous record. False on
+  // out-of-order input or when memory runs out; the builder is then failed() for good.
+  bool add(uint32_t fid, const StaffRecord& r);
+  // Moves the directory out; false if the build failed.
+  bool finish(StaffDirectory& out);
+  bool failed() const { return failed_; }
+  size_t count() const { return dir_.count_ + n_; }
+
+private:
+  bool flush();
+
+  StaffDirectory dir_;
+  uint32_t fids_[StaffDirectory::kBlock];
+  StaffRecord recs_[StaffDirectory::kBlock];
+  uint8_t n_ = 0;
+  bool failed_ = false;
+};
+
+// The directory plus changes made since it was built (a short sorted list, searched first).
+// replace() installs the next sync's directory and drops the changes (the server has them by
+// then; aliases are re-applied by the caller).
+class StaffMap {
+public:
+  bool find(uint32_t fid, StaffRecord& out) const;
+  bool contains(uint32_t fid) const { StaffRecord r; return find(fid, r); }
+  void set(uint32_t fid, const StaffRecord& r);
+  void erase(uint32_t fid);
+  size_t size() const;
+  void replace(StaffDirectory&& dir);
+  void clear();
+  const StaffDirectory& directory() const { return dir_; }
+
+  // Calls f(fid, record) in ascending fid order, changes applied.
+  template <class F> void forEach(F f) const {
+    size_t k = 0;
+    dir_.forEach([&](uint32_t fid, const StaffRecord& r) {
+      for (; k < overlay_.size() && overlay_[k].fid < fid; k++) {
+        if (!overlay_[k].erased) f(overlay_[k].fid, overlay_[k].rec);
+      }
+      if (k < overlay_.size() && overlay_[k].fid == fid) {
+        if (!overlay_[k].erased) f(fid, overlay_[k].rec);
+        k++;
+      } else {
+        f(fid, r);
+      }
+    });
+    for (; k < overlay_.size(); k++) if (!overlay_[k].erased) f(overlay_[k].fid, overlay_[k].rec);
+  }
+
+private:
+  struct Change { uint32_t fid; StaffRecord rec; bool erased; };
+  Change* change(uint32_t fid);
+  const Change* change(uint32_t fid) const;
+
+  StaffDirectory dir_;
+  std::vector<Change> overlay_; // sorted by fid
+};
@@ -0,0 +1,74 @@
+// Stall detector for the long-running tasks. Each watched task marks where it is with stage()
+// (also its heartbeat); a periodic esp_timer checker flags a task whose last mark is older than
+// its budget and records task, stage, how long so far and a short backtrace into a ring in RTC
+// memory, so stalls that end in a watchdog reset or panic are still there after the reboot.
+// The backtrace is the one taken when the stalled stage was entered (another task's live stack
+// cannot be walked from the checker); the stage narrows it to one step of the loop. The record
+// is closed with the final duration when the task marks its next stage. report() logs new
+// records and, after a reset, the ones from earlier boots.
+// Also keeps the hourly scan SLO: finger-to-answer times against a target.
+#pragma once
+
+#include <Arduino.h>
+
+class StallWatchdog {
+public:
+  static const uint8_t kTasks = 3;
+  static const uint8_t kRing = 8;
+  static const uint8_t kFrames = 4;
+
+  struct Record {
+    uint32_t boot;        // boot number the stall happened in
+    uint32_t atMs;        // millis() when the stage was entered
+    uint32_t durationMs;  // so far while open, final once closed
+    uint32_t budgetMs;
+    uint32_t pc[kFrames]; // callers of stage(), innermost first
+    char task[12];
+    char stage[20];
+    uint8_t open;         // task still stalled (or reset while stalled)
+    uint8_t logged;       // bit0: flag logged, bit1: close logged
+  };
+
+  struct SloHour { uint32_t answered; uint32_t withinTarget; uint32_t worstMs; uint32_t stalls; };
+
+  // setup(), before begin(). Returns the id for stage(), -1 when the table is full.
+  int8_t addTask(const char* name, uint32_t budgetMs);
+  // Restores the ring from RTC memory and starts the checker.
+  void begin(uint32_t checkEveryMs, uint32_t sloTargetMs);
+
+  // Heartbeat: `stage` (a literal) is what the task does from now on.
+  void stage(int8_t task, const char* stage);
+  // A deliberate wait of unknown length (blocking connect with its own timeout, vTaskDelay
+  // backoff) that should not count as a stall; the next stage() resumes watching.
+  void sleep(int8_t task);
+
+  // Logs records not logged yet. Any task; keep it outside sharedMutex (Serial may block).
+  void report();
+
+  // Main thread: one answered scan, finger on glass to verdict on the display.
+  void noteAnswer(uint32_t ms);
+  // Main thread: returns the hour's counts and starts a new hour.
+  SloHour takeHour();
+  uint32_t sloTargetMs() const { return sloTargetMs_; }
+
+  // Checker (esp_timer task).
+  void check(uint32_t now);
+
+private:
+  struct Watched {
+    const char* name;
+    uint32_t budgetMs;
+    volatile uint32_t beatMs;
+    const char* volatile stage;
+    uint32_t pc[kFrames];
+    bool sleeping;
+    uint32_t record;      // sequence number of the open stall's record, 0 = none
+  };
+
+  Watched tasks_[kTasks] = {};
+  uint8_t taskCount_ = 0;
+  uint32_t sloTargetMs_ = 0;
+  SloHour hour_ = {};
+  uint32_t boot_ = 0;
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
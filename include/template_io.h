@@ -0,0 +1,42 @@
+// Raw template transfer between the sensor's char buffer and the host (UpChar 0x08 /
+// DownChar 0x09). Adafruit_Fingerprint only wraps the command half of these and its packet
+// struct tops out at 64 data bytes, so the data phase is framed here (zfm_frame.h) directly
+// on the sensor UART. The library is still used for LoadChar/Store. Main thread only: the
+// caller owns the sensor for the duration of a call (~100-200 ms at 57600 baud for a
+// 512-byte template).
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_Fingerprint.h>
+#include "zfm_frame.h"
+
+class TemplateIO {
+public:
+  static const size_t kMaxTemplateBytes = 2048;
+
+  TemplateIO(Adafruit_Fingerprint& finger, Stream& port) : finger_(finger), port_(port) {}
+
+  // Reads packet length / address from the sensor; call once the sensor answered.
+  bool begin();
+
+  // Copies slot `fid` out of the sensor. Returns the template length, or -1.
+  int exportSlot(uint16_t fid, uint8_t* out, size_t cap);
+  // Writes `data` into slot `fid`, overwriting whatever was there.
+  bool importSlot(uint16_t fid, const uint8_t* data, size_t len);
+  // True if slot `fid` holds a template (LoadChar succeeds).
+  bool slotUsed(uint16_t fid);
+  // Duplicates slot `from` into `to` through the host (the sensor has no slot-to-slot copy).
+  bool copySlot(uint16_t from, uint16_t to);
+  bool deleteSlot(uint16_t fid);
+
+private:
+  // Returns the payload length, or -1 on timeout / checksum error.
+  int readFrame(uint8_t& pid, uint8_t* payload, size_t cap, uint32_t timeoutMs);
+  bool command(uint8_t code, uint8_t arg);
+
+  Adafruit_Fingerprint& finger_;
+  Stream& port_;
+  uint32_t addr_ = 0xFFFFFFFF;
+  uint16_t packetLen_ = 128;
+  ZfmParser parser_;
+};
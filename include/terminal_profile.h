@@ -0,0 +1,72 @@
+// Build profiles: which components a terminal firmware carries, fixed at compile time. A profile
+// composes one policy per component (display transport, sensor driver, sync strategy, log level,
+// metrics); main.cpp tests the policies with `if constexpr`, so a path a profile leaves out is
+// never emitted and the linker drops what only it referenced (ESP-NOW, the websocket task,
+// gossip, stats formatting). Pick one with -DTERMINAL_PROFILE=<name> (see platformio.ini); the
+// default is FullTerminalProfile, the behaviour this sketch always had. Needs C++17.
+#pragma once
+
+#include <Arduino.h>
+
+// ---- Display transport ----
+struct DisplayOverUart       { static constexpr bool kUart = true,  kEspNow = false; };
+struct DisplayOverUartEspNow { static constexpr bool kUart = true,  kEspNow = true;  }; // ESP-NOW as fallback
+struct DisplayOverEspNow     { static constexpr bool kUart = false, kEspNow = true;  }; // frees UART2
+
+// ---- Sensor driver: capture lanes, one sensor per UART ----
+template <uint8_t Lanes>
+struct SensorLanes {
+  static_assert(Lanes >= 1 && Lanes <= 2, "only two sensor lanes fit the ESP32's UARTs");
+  static constexpr uint8_t kLanes = Lanes;
+};
+
+// ---- Sync strategy: what runs beside the polled REST sync ----
+struct SyncPollOnly     { static constexpr bool kControlPush = false, kGossip = false; };
+struct SyncPushAndPoll  { static constexpr bool kControlPush = true,  kGossip = false; };
+struct SyncPushGossip   { static constexpr bool kControlPush = true,  kGossip = true;  };
+
+// ---- Log level: TLOG_INFO lines (per-scan chatter) exist only at LogInfo ----
+struct LogQuiet { static constexpr uint8_t kLevel = 0; };
+struct LogInfo  { static constexpr uint8_t kLevel = 1; };
+
+// ---- Metrics: periodic match/search/display/gossip stats logs ----
+struct MetricsOff { static constexpr bool kLog = false; };
+struct MetricsOn  { static constexpr bool kLog = true;  };
+
+template <class DisplayP, class SensorP, class SyncP, class LogP, class MetricsP>
+struct TerminalProfile {
+  using Display = DisplayP;
+  using Sensor = SensorP;
+  using Sync = SyncP;
+  using Log = LogP;
+  using Metrics = MetricsP;
+  static_assert(Display::kUart || Display::kEspNow, "the display needs UART2 or ESP-NOW");
+  static_assert(Sensor::kLanes == 1 || !Display::kUart, "sensor lane 1 needs UART2, which carries the display link");
+};
+
+// Every component, one sensor: the reference build.
+struct FullTerminalProfile
+    : TerminalProfile<DisplayOverUartEspNow, SensorLanes<1>, SyncPushGossip, LogInfo, MetricsOn> {
+  static constexpr const char* kName = "full";
+};
+
+// One serving line on a wired display: no ESP-NOW, no websocket task, no gossip, no per-scan
+// logging or stats. Register mode is picked up by the control poll alone.
+struct LeanCanteenProfile
+    : TerminalProfile<DisplayOverUart, SensorLanes<1>, SyncPollOnly, LogQuiet, MetricsOff> {
+  static constexpr const char* kName = "lean";
+};
+
+// Two sensors on one terminal, display over ESP-NOW.
+struct DualLaneProfile
+    : TerminalProfile<DisplayOverEspNow, SensorLanes<2>, SyncPushGossip, LogInfo, MetricsOn> {
+  static constexpr const char* kName = "dual";
+};
+
+#ifndef TERMINAL_PROFILE
+#define TERMINAL_PROFILE FullTerminalProfile
+#endif
+using Profile = TERMINAL_PROFILE;
+
+// Informational log line; compiled out (format string included) when the profile is quiet.
+#define TLOG_INFO(...) do { if constexpr (Profile::Log::kLevel >= 1) Serial.printf(__VA_ARGS__); } while (0)
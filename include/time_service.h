@@ -0,0 +1,77 @@
+// Wall-clock helpers for the scan path. The date prefix, UTC offset suffix and "HH:MM" are
+// recomputed once a day / once a minute by tick(); timestamps are then assembled from the
+// current seconds-of-day with integer math into caller buffers, with no heap allocation.
+// tick() may be called from any task; readers copy the cached fields under a spinlock.
+//
+// Trust: the wall clock is only "trusted" after an SNTP sync this boot, or after a soft reset
+// that kept the RTC-backed system time past the last sync. Every sync anchors wall time to
+// millis() and refines a drift estimate, so a millis() stamp taken while untrusted can be
+// converted to wall time later (wallFromMillis). The anchor is kept in RTC memory across
+// soft resets and the drift estimate in flash across power cycles.
+#pragma once
+
+#include <Arduino.h>
+#include <sys/time.h>
+#include <time.h>
+
+class TimeService {
+public:
+  typedef void (*DayRolloverFn)(uint32_t oldDayKey, uint32_t newDayKey);
+
+  // Called (outside the lock) when the local date changes, including the first time the clock
+  // becomes trusted (oldDayKey == 0 then). It runs in whichever task's tick() noticed the new
+  // day, which may be networkTask through a getter as well as loop(): keep it to setting flags
+  // or to state that is safe from any task.
+  void onDayRollover(DayRolloverFn fn) { rolloverFn_ = fn; }
+
+  // Cheap unless a second boundary has passed. The getters below tick themselves; loop() also
+  // calls it so the rollover event fires at midnight even when nobody is scanning.
+  void tick();
+
+  // "2026-10-18T12:34:56.789+01:00" (ms < 0 omits the fraction). Returns the length written,
+  // 0 if `len` is too small. Falls back to localtime_r for instants outside the cached day.
+  size_t formatIso(time_t epoch, int ms, char* out, size_t len);
+  size_t formatIsoNow(char* out, size_t len);
+
+  // "HH:MM" into out (at least 6 bytes); "--:--" while untrusted.
+  void hhmm(char* out);
+  // "YYYY-MM-DD" into out (at least 11 bytes).
+  void date(char* out);
+  // yyyymmdd for the local date, or 0 while the clock is untrusted.
+  uint32_t dayKey();
+
+  // Restores the drift estimate and, after a soft reset, trust; hooks the SNTP notification.
+  // Call once from setup() before configTime().
+  void begin();
+  // SNTP sync notification (runs in the lwIP task): re-anchor, update drift, mark trusted.
+  void noteSync(const struct timeval& tv);
+  bool trusted() const { return trusted_; }
+  // Wall time for a millis() stamp from this boot. False while untrusted.
+  bool wallFromMillis(uint32_t monoMs, time_t& sec, int& ms);
+  // Writes the drift estimate to flash if it changed, at most every few hours. networkTask only.
+  void persistIfDue(uint32_t nowMs);
+  float driftPpm() const { return driftPpm_; }
+  uint32_t syncCount() const { return syncs_; }
+
+private:
+  void anchorLocked(int64_t wallMs, uint32_t monoMs);
+
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+  time_t dayStart_ = 0;        // epoch of local midnight for the cached day
+  time_t lastSecond_ = -1;
+  uint32_t dayKey_ = 0;
+  char datePrefix_[12] = "";   // "YYYY-MM-DDT"
+  char offset_[7] = "";        // "+01:00"
+  char hhmm_[6] = "--:--";
+  DayRolloverFn rolloverFn_ = nullptr;
+
+  volatile bool trusted_ = false;
+  bool anchored_ = false;
+  int64_t anchorWallMs_ = 0;   // wall time (ms since epoch) at the last sync
+  uint32_t anchorMono_ = 0;    // millis() at the last sync
+  float driftPpm_ = 0;         // system clock error vs NTP; + means the local clock runs slow
+  bool driftValid_ = false;
+  uint32_t syncs_ = 0;
+  bool driftDirty_ = false;
+  uint32_t lastPersistMs_ = 0;
+};
@@ -0,0 +1,34 @@
+// Minimal WebSocket client (RFC 6455, text frames only) on top of an Arduino Client.
+// Used for the Supabase Realtime control channel; runs in its own task, not thread safe.
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+class WsClient {
+public:
+  explicit WsClient(Client& client) : client_(client) {}
+
+  // Opens the TCP/TLS connection and performs the HTTP upgrade. Blocks for up to timeoutMs.
+  bool connect(const char* host, uint16_t port, const String& path, unsigned long timeoutMs = 8000);
+  void close();
+  bool connected();
+
+  // Sends one masked text frame.
+  bool sendText(const String& text);
+
+  // Reads whatever frames are waiting. Returns 1 and fills `out` when a complete text message
+  // arrived, 0 if nothing (or only control frames) was pending, -1 if the connection is gone.
+  int poll(String& out);
+
+  unsigned long lastRxMs() const { return lastRx_; }
+
+private:
+  bool writeFrame(uint8_t opcode, const uint8_t* data, size_t len);
+  bool readExact(uint8_t* buf, size_t len);
+
+  Client& client_;  // WiFiClientSecure for Supabase, plain WiFiClient for a local stand-in
+  unsigned long lastRx_ = 0;
+  String partial_;              // fragmented text message being reassembled
+  static const size_t kMaxMessage = 4096;
+};
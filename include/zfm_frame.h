@@ -0,0 +1,34 @@
+// ZFM/R30x sensor framing, shared by the raw template transfer and the non-blocking capture
+// lanes: EF 01 | addr(4) | pid | len(2, payload + checksum) | payload | sum(2).
+#pragma once
+
+#include <Arduino.h>
+
+static const uint8_t ZFM_PID_COMMAND = 0x01;
+static const uint8_t ZFM_PID_DATA = 0x02;
+static const uint8_t ZFM_PID_ACK = 0x07;
+static const uint8_t ZFM_PID_END_DATA = 0x08;
+
+void zfmWriteFrame(Stream& port, uint32_t addr, uint8_t pid, const uint8_t* payload, size_t len);
+
+// Incremental frame parser: feed bytes as they arrive, resyncing on the start code.
+class ZfmParser {
+public:
+  static const size_t kMaxPayload = 288; // 256-byte data packets plus headroom
+
+  void reset() { got_ = 0; }
+  // 1 = a frame is complete (pid()/payload()/length() valid until the next feed), 0 = need
+  // more bytes, -1 = bad length or checksum (parser already reset).
+  int feed(uint8_t b);
+
+  uint8_t pid() const { return hdr_[6]; }
+  const uint8_t* payload() const { return payload_; }
+  size_t length() const { return len_ - 2; }
+
+private:
+  uint8_t hdr_[9];
+  uint8_t payload_[kMaxPayload];
+  size_t got_ = 0;
+  uint16_t len_ = 0;
+  uint16_t sum_ = 0;
+};
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+# Lines up scan latency across terminal profiles. Flash each profile, serve a rush (or replay the
+# same set of fingers), type "lat" on the serial console and keep the log; then
+#
+#   scripts/profile_latency.py lean.log dual.log full.log
+#
+# prints finger-to-outcome times per profile and outcome, summed over the profile's lanes, with
+# the average's difference to the first log. Other lines in the logs are ignored; the last
+# "LAT ... LAT end" block of each log wins.
+import argparse
+import collections
+import re
+import sys
+
+LAT = re.compile(r"LAT (\S+) (\d+) (\d+) (\d+) (\d+) (.+)$")
+
+
+def parse(path):
+    block, last, profile = [], None, None
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\r\n")
+            i = line.find("LAT ")
+            if i < 0:
+                continue
+            line = line[i:]
+            if line == "LAT end":
+                last, block = block, []
+                continue
+            m = LAT.match(line)
+            if m:
+                block.append(m.groups())
+    if last is None:
+        return None, {}
+    per = collections.OrderedDict()
+    for name, _lane, count, total, worst, outcome in last:
+        profile = name
+        c = per.setdefault(outcome, [0, 0, 0])
+        c[0] += int(count)
+        c[1] += int(total)
+        c[2] = max(c[2], int(worst))
+    return profile, per
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Compare scan latency between terminal profiles.")
+    ap.add_argument("logs", nargs="+", help="serial logs holding a \"lat\" dump, one per profile")
+    opts = ap.parse_args()
+
+    runs = []
+    for path in opts.logs:
+        profile, per = parse(path)
+        if profile is None:
+            sys.exit("%s: no complete LAT block (type \"lat\" on the console)" % path)
+        runs.append((profile, path, per))
+
+    base = runs[0][2]
+    print("%-8s %-24s %7s %9s %9s %9s" % ("profile", "outcome", "scans", "avg ms", "max ms", "vs " + runs[0][0]))
+    for profile, path, per in runs:
+        for outcome, (count, total, worst) in per.items():
+            avg = total / count
+            delta = ""
+            if outcome in base and (profile, path) != (runs[0][0], runs[0][1]):
+                b = base[outcome]
+                delta = "%+.0f" % (avg - b[1] / b[0])
+            print("%-8s %-24s %7d %9.0f %9d %9s" % (profile, outcome, count, avg, worst, delta))
+
+
+if __name__ == "__main__":
+    main()
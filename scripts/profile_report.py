@@ -0,0 +1,61 @@
+# Post-build step for every terminal profile: records the firmware's flash and static RAM use in
+# .pio/build/profile_sizes.json and prints it next to the other profiles built so far, with the
+# difference to the full terminal (env esp32dev).
+Import("env")
+
+import json
+import os
+import subprocess
+
+REFERENCE = "esp32dev"
+
+
+def section_sizes(elf):
+    out = subprocess.check_output([env.subst("$SIZETOOL"), "-A", elf]).decode()
+    sizes = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) >= 2 and parts[0].startswith(".") and parts[1].isdigit():
+            sizes[parts[0]] = int(parts[1])
+    return sizes
+
+
+def summarize(sizes):
+    # Flash: everything the image carries; RAM: initialised data, bss and code placed in IRAM
+    flash = sum(v for k, v in sizes.items() if k.startswith((".flash.", ".iram0.", ".dram0.data")))
+    dram = sizes.get(".dram0.data", 0) + sizes.get(".dram0.bss", 0)
+    iram = sum(v for k, v in sizes.items() if k.startswith(".iram0."))
+    return {"flash": flash, "dram": dram, "iram": iram}
+
+
+def profile_of(e):
+    for flag in e.get("CPPDEFINES", []):
+        if isinstance(flag, (list, tuple)) and flag[0] == "TERMINAL_PROFILE":
+            return str(flag[1])
+    return "FullTerminalProfile"
+
+
+def report(source, target, env):
+    name = env["PIOENV"]
+    path = os.path.join(env.subst("$PROJECT_BUILD_DIR"), "profile_sizes.json")
+    table = {}
+    if os.path.isfile(path):
+        with open(path) as f:
+            table = json.load(f)
+    row = summarize(section_sizes(str(source[0])))
+    row["profile"] = profile_of(env)
+    table[name] = row
+    with open(path, "w") as f:
+        json.dump(table, f, indent=2, sort_keys=True)
+
+    ref = table.get(REFERENCE)
+    print("Terminal profiles (bytes; delta vs %s):" % REFERENCE)
+    print("  %-10s %-22s %10s %9s %9s %9s %9s" % ("env", "profile", "flash", "d", "dram", "d", "iram"))
+    for env_name in sorted(table):
+        r = table[env_name]
+        df = r["flash"] - ref["flash"] if ref else 0
+        dd = r["dram"] - ref["dram"] if ref else 0
+        print("  %-10s %-22s %10d %+9d %9d %+9d %9d" % (env_name, r["profile"], r["flash"], df, r["dram"], dd, r["iram"]))
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", report)
@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+# Symbolizes a sampling profiler dump ("prof dump" on the terminal's serial console, see
+# include/sampling_profiler.h). Reads the captured log (other lines are ignored), maps the PC
+# buckets to functions with addr2line against the firmware ELF of the same build, and prints per
+# core the functions and tasks that took the most samples. A bucket that spans the end of one
+# function and the start of the next is listed as "first / second".
+#
+#   pio device monitor | tee rush.log          (then type "prof start", later "prof dump")
+#   scripts/symbolize_profile.py .pio/build/esp32dev/firmware.elf rush.log
+import argparse
+import collections
+import os
+import re
+import subprocess
+import sys
+
+ADDR2LINE = "xtensa-esp32-elf-addr2line"
+
+BEGIN = re.compile(r"PROF begin hz=(\d+) ms=(\d+)(?: bucket=(\d+))?")
+CORE = re.compile(r"PROF core (\d+) samples=(\d+) isr=(\d+) dropped=(\d+) other_tasks=(\d+) overhead=([\d.]+)%")
+TASK = re.compile(r"PROF task (\d+) (\d+) (.*)$")
+PC = re.compile(r"PROF pc (\d+) 0x([0-9a-fA-F]+) (\d+)")
+
+
+def parse(lines):
+    # the last complete dump in the log wins
+    dump = None
+    current = None
+    for line in lines:
+        line = line.rstrip("\r\n")
+        i = line.find("PROF ")
+        if i < 0:
+            continue
+        line = line[i:]
+        m = BEGIN.match(line)
+        if m:
+            current = {"hz": int(m.group(1)), "ms": int(m.group(2)), "bucket": int(m.group(3) or 1),
+                       "cores": {}, "tasks": [], "pcs": []}
+            continue
+        if current is None:
+            continue
+        if line.startswith("PROF end"):
+            dump, current = current, None
+            continue
+        m = CORE.match(line)
+        if m:
+            core = int(m.group(1))
+            current["cores"][core] = {"samples": int(m.group(2)), "isr": int(m.group(3)),
+                                      "dropped": int(m.group(4)), "other_tasks": int(m.group(5)),
+                                      "overhead": float(m.group(6))}
+            continue
+        m = TASK.match(line)
+        if m:
+            current["tasks"].append((int(m.group(1)), m.group(3).strip(), int(m.group(2))))
+            continue
+        m = PC.match(line)
+        if m:
+            current["pcs"].append((int(m.group(1)), int(m.group(2), 16), int(m.group(3))))
+    return dump
+
+
+def addr2line_run(elf, addr2line, addrs):
+    args = [addr2line, "-f", "-C", "-e", elf] + ["0x%08x" % a for a in addrs]
+    out = subprocess.check_output(args).decode(errors="replace").splitlines()
+    found = {}
+    for n, a in enumerate(addrs):
+        func = out[2 * n] if 2 * n < len(out) else "??"
+        where = out[2 * n + 1] if 2 * n + 1 < len(out) else "??:0"
+        found[a] = (func, os.path.basename(where.split(" ")[0]))
+    return found
+
+
+# bucket base -> (function, source line of the bucket's first address)
+def symbolize(elf, addr2line, pcs, bucket):
+    if not pcs:
+        return {}
+    ends = [pc + bucket - 1 for pc in pcs] if bucket > 1 else []
+    found = addr2line_run(elf, addr2line, pcs + ends)
+    names = {}
+    for pc in pcs:
+        func, where = found[pc]
+        if bucket > 1:
+            last = found[pc + bucket - 1][0]
+            if last != func:
+                func = "%s / %s" % (func, last)
+        names[pc] = (func, where)
+    return names
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Symbolize a sampling profiler dump.")
+    ap.add_argument("elf", help="firmware.elf of the build running on the terminal")
+    ap.add_argument("log", nargs="?", help="captured serial log (default: stdin)")
+    ap.add_argument("--top", type=int, default=25, help="functions listed per core")
+    ap.add_argument("--lines", action="store_true",
+                    help="rank source lines (the first line of each PC bucket) instead of functions")
+    ap.add_argument("--max-dropped", type=float, default=5.0,
+                    help="warn when more than this %% of a core's samples found the PC table full")
+    ap.add_argument("--addr2line", default=ADDR2LINE)
+    opts = ap.parse_args()
+
+    with (open(opts.log, errors="replace") if opts.log else sys.stdin) as f:
+        dump = parse(f)
+    if dump is None:
+        sys.exit("no complete PROF begin..end dump in the input")
+
+    names = symbolize(opts.elf, opts.addr2line, sorted({pc for _, pc, _ in dump["pcs"]}), dump["bucket"])
+    print("Profile: %d Hz per core over %.1f s, %d-byte PC buckets" % (dump["hz"], dump["ms"] / 1000.0, dump["bucket"]))
+    for core in sorted(dump["cores"]):
+        c = dump["cores"][core]
+        total = c["samples"]
+        if total == 0:
+            continue
+        print("\nCore %d: %d samples, %d in other interrupts, %d dropped (PC table full), sampler %.3f%% of the CPU"
+              % (core, total, c["isr"], c["dropped"], c["overhead"]))
+        dropped = 100.0 * c["dropped"] / total
+        if dropped > opts.max_dropped:
+            print("  WARNING: %.1f%% of the samples were dropped, so the functions below are biased towards the"
+                  " code that ran first; profile a shorter window" % dropped)
+
+        print("  Tasks:")
+        for _, name, count in sorted((t for t in dump["tasks"] if t[0] == core), key=lambda t: -t[2]):
+            print("    %6.2f%% %7d  %s" % (100.0 * count / total, count, name))
+        if c["other_tasks"]:
+            print("    %6.2f%% %7d  (more tasks than the table holds)" % (100.0 * c["other_tasks"] / total, c["other_tasks"]))
+
+        by = collections.Counter()
+        for pc_core, pc, count in dump["pcs"]:
+            if pc_core != core:
+                continue
+            func, where = names.get(pc, ("??", "??:0"))
+            by[where if opts.lines else "%s  (%s)" % (func, where.split(":")[0])] += count
+        print("  %s:" % ("Lines" if opts.lines else "Functions"))
+        for key, count in by.most_common(opts.top):
+            print("    %6.2f%% %7d  %s" % (100.0 * count / total, count, key))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,119 @@
+#include "alloc_guard.h"
+
+#ifdef ALLOC_GUARD
+
+// One entry per task that allocated or entered a scope; tasks live for the whole uptime here.
+struct GuardTask {
+  TaskHandle_t task;
+  char name[16];
+  uint8_t depth;         // nested NoAllocScopes
+  const char* scope;     // outermost scope while depth > 0
+  uint32_t allocs;
+  uint32_t violations;
+  const char* firstScope;
+  void* firstCaller;
+  size_t firstSize;
+};
+
+static const uint8_t kGuardTasks = 8;
+static GuardTask guardTasks[kGuardTasks];
+static uint8_t guardTaskCount = 0;
+static uint32_t guardUntracked = 0; // allocations from tasks past the table
+static portMUX_TYPE guardMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Caller holds guardMux.
+static GuardTask* guardEntry(TaskHandle_t me) {
+  for (uint8_t i = 0; i < guardTaskCount; i++) if (guardTasks[i].task == me) return &guardTasks[i];
+  if (guardTaskCount == kGuardTasks) return nullptr;
+  GuardTask* g = &guardTasks[guardTaskCount++];
+  *g = {};
+  g->task = me;
+  const char* name = me ? pcTaskGetTaskName(me) : "boot";
+  strncpy(g->name, name ? name : "?", sizeof(g->name) - 1);
+  return g;
+}
+
+static void guardNote(size_t size, void* caller) {
+  TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&guardMux);
+  GuardTask* g = guardEntry(me);
+  if (!g) {
+    guardUntracked++;
+  } else {
+    g->allocs++;
+    if (g->depth > 0) {
+      if (g->violations++ == 0) {
+        g->firstScope = g->scope;
+        g->firstCaller = caller;
+        g->firstSize = size;
+      }
+    }
+  }
+  portEXIT_CRITICAL(&guardMux);
+}
+
+extern "C" {
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+
+void* __wrap_malloc(size_t size) {
+  guardNote(size, __builtin_return_address(0));
+  return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+  guardNote(n * size, __builtin_return_address(0));
+  return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* p, size_t size) {
+  guardNote(size, __builtin_return_address(0));
+  return __real_realloc(p, size);
+}
+}
+
+NoAllocScope::NoAllocScope(const char* name) {
+  TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&guardMux);
+  GuardTask* g = guardEntry(me);
+  if (g && g->depth++ == 0) g->scope = name;
+  portEXIT_CRITICAL(&guardMux);
+}
+
+NoAllocScope::~NoAllocScope() {
+  TaskHandle_t me = xTaskGetCurrentTaskHandle();
+  portENTER_CRITICAL(&guardMux);
+  GuardTask* g = guardEntry(me);
+  if (g && g->depth > 0) g->depth--;
+  portEXIT_CRITICAL(&guardMux);
+}
+
+void allocGuardReport() {
+  GuardTask snap[kGuardTasks];
+  uint8_t n;
+  uint32_t untracked;
+  portENTER_CRITICAL(&guardMux);
+  n = guardTaskCount;
+  memcpy(snap, guardTasks, sizeof(GuardTask) * n);
+  untracked = guardUntracked;
+  portEXIT_CRITICAL(&guardMux);
+
+  for (uint8_t i = 0; i < n; i++) {
+    const GuardTask& g = snap[i];
+    if (g.violations) {
+      Serial.printf("Alloc guard: %-12s %lu allocs, %lu in no-alloc scopes (first in %s: %u bytes from %p)\n",
+                    g.name, (unsigned long)g.allocs, (unsigned long)g.violations,
+                    g.firstScope ? g.firstScope : "?", (unsigned)g.firstSize, g.firstCaller);
+    } else {
+      Serial.printf("Alloc guard: %-12s %lu allocs, none in no-alloc scopes\n", g.name, (unsigned long)g.allocs);
+    }
+  }
+  if (untracked) Serial.printf("Alloc guard: %lu allocs from untracked tasks\n", (unsigned long)untracked);
+}
+
+#else
+
+void allocGuardReport() {}
+
+#endif
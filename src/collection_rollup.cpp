@@ -0,0 +1,156 @@
+#include "collection_rollup.h"
+
+#include <Preferences.h>
+#include <algorithm>
+
+static const uint8_t kLayout = 1; // bump when Cell changes; an older saved table is dropped
+
+void CollectionRollup::begin(const char* nvsNamespace, uint32_t saveMinIntervalMs) {
+  nvs_ = nvsNamespace;
+  saveMinIntervalMs_ = saveMinIntervalMs;
+  Preferences prefs;
+  if (!prefs.begin(nvs_, true)) return;
+  bool ok = prefs.getUChar("layout", 0) == kLayout && prefs.getBytesLength("cells") == sizeof(cells_) &&
+            prefs.getBytes("cells", cells_, sizeof(cells_)) == sizeof(cells_);
+  prefs.end();
+  if (!ok) {
+    memset(cells_, 0, sizeof(cells_));
+    return;
+  }
+  uint8_t used = 0, pending = 0;
+  for (const Cell& c : cells_) {
+    if (!c.hour) continue;
+    used++;
+    if (c.served != c.uploaded) pending++;
+  }
+  Serial.printf("Rollups loaded: %u hour/tag counters, %u not uploaded yet\n", used, pending);
+}
+
+uint32_t CollectionRollup::currentHour() const {
+  if (!clock_.trusted()) return 0;
+  return (uint32_t)(time(nullptr) / 3600);
+}
+
+// Caller holds mux_.
+void CollectionRollup::addLocked(uint32_t hour, int tag) {
+  Cell* slot = nullptr;
+  for (Cell& c : cells_) {
+    if (c.hour == hour && c.tag == tag) { slot = &c; break; }
+    if (!slot && c.hour == 0) slot = &c;
+  }
+  if (!slot) {
+    // full: reuse the oldest hour the server already has, else lose the oldest unsent one
+    Cell* oldestSent = nullptr;
+    Cell* oldest = &cells_[0];
+    for (Cell& c : cells_) {
+      if (c.served == c.uploaded && (!oldestSent || c.hour < oldestSent->hour)) oldestSent = &c;
+      if (c.hour < oldest->hour) oldest = &c;
+    }
+    slot = oldestSent ? oldestSent : oldest;
+    if (slot->hour > hour) { // a late serve for an hour older than anything worth evicting
+      dropped_++;
+      return;
+    }
+    dropped_ += (uint32_t)(slot->served - slot->uploaded);
+    *slot = {};
+  }
+  if (slot->hour == 0) {
+    slot->hour = hour;
+    slot->tag = (int16_t)tag;
+  }
+  if (slot->served < UINT16_MAX) slot->served++;
+  dirty_ = true;
+}
+
+void CollectionRollup::note(int tag, uint32_t scanMs) {
+  time_t sec = 0; int ms;
+  bool dated = clock_.wallFromMillis(scanMs, sec, ms);
+  portENTER_CRITICAL(&mux_);
+  if (dated) {
+    addLocked((uint32_t)(sec / 3600), tag);
+  } else if (undatedCount_ < kUndated) {
+    undated_[undatedCount_++] = { scanMs, (int16_t)tag };
+  } else {
+    dropped_++;
+  }
+  portEXIT_CRITICAL(&mux_);
+}
+
+uint8_t CollectionRollup::dateUndated() {
+  if (!undatedCount_ || !clock_.trusted()) return 0;
+  Undated pending[kUndated];
+  portENTER_CRITICAL(&mux_);
+  uint8_t n = undatedCount_;
+  memcpy(pending, undated_, n * sizeof(Undated));
+  undatedCount_ = 0;
+  portEXIT_CRITICAL(&mux_);
+
+  uint32_t hours[kUndated];
+  for (uint8_t i = 0; i < n; i++) {
+    time_t sec = 0; int ms;
+    clock_.wallFromMillis(pending[i].monoMs, sec, ms);
+    hours[i] = (uint32_t)(sec / 3600);
+  }
+  portENTER_CRITICAL(&mux_);
+  for (uint8_t i = 0; i < n; i++) addLocked(hours[i], pending[i].tag);
+  portEXIT_CRITICAL(&mux_);
+  return n;
+}
+
+uint8_t CollectionRollup::changed(Cell* out, uint8_t max) const {
+  uint8_t n = 0;
+  portENTER_CRITICAL(&mux_);
+  for (const Cell& c : cells_) {
+    if (n == max) break;
+    if (c.hour && c.served != c.uploaded) out[n++] = c;
+  }
+  portEXIT_CRITICAL(&mux_);
+  return n;
+}
+
+void CollectionRollup::uploaded(const Cell* cells, uint8_t n) {
+  portENTER_CRITICAL(&mux_);
+  for (uint8_t i = 0; i < n; i++) {
+    for (Cell& c : cells_) {
+      // the count may have grown since the copy was taken; that part is still unsent
+      if (c.hour == cells[i].hour && c.tag == cells[i].tag) { c.uploaded = cells[i].served; break; }
+    }
+  }
+  dirty_ = true;
+  // The server now holds these counts and keeps the larger value: a reset that restored an
+  // older, smaller copy would have its new serves masked until they caught up.
+  saveNow_ = true;
+  portEXIT_CRITICAL(&mux_);
+}
+
+void CollectionRollup::persistIfDue(uint32_t nowMs) {
+  if (!dirty_ || !nvs_) return;
+  if (!saveNow_ && lastSaveMs_ != 0 && nowMs - lastSaveMs_ < saveMinIntervalMs_) return;
+  lastSaveMs_ = nowMs;
+  saveNow_ = false;
+  Cell copy[kCells];
+  portENTER_CRITICAL(&mux_);
+  memcpy(copy, cells_, sizeof(copy));
+  dirty_ = false;
+  portEXIT_CRITICAL(&mux_);
+
+  Preferences prefs;
+  if (!prefs.begin(nvs_, false)) { dirty_ = true; return; }
+  prefs.putUChar("layout", kLayout);
+  if (prefs.putBytes("cells", copy, sizeof(copy)) != sizeof(copy)) dirty_ = true;
+  prefs.end();
+}
+
+uint8_t CollectionRollup::since(uint32_t fromHour, Cell* out, uint8_t max) const {
+  uint8_t n = 0;
+  portENTER_CRITICAL(&mux_);
+  for (const Cell& c : cells_) {
+    if (n == max) break;
+    if (c.hour && c.hour >= fromHour) out[n++] = c;
+  }
+  portEXIT_CRITICAL(&mux_);
+  std::sort(out, out + n, [](const Cell& a, const Cell& b) {
+    return a.hour != b.hour ? a.hour < b.hour : a.tag < b.tag;
+  });
+  return n;
+}
@@ -0,0 +1,162 @@
+// Fixed-size control-row state table — see include/control_table.h
+#include "control_table.h"
+
+const ControlUuid kNilControlUuid = {};
+
+static int hexVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool parseControlUuid(const char* s, ControlUuid& out) {
+  if (!s) return false;
+  int n = 0;
+  for (; *s && n < 32; s++) {
+    if (*s == '-') continue;
+    int v = hexVal(*s);
+    if (v < 0) return false;
+    if (n & 1) out.b[n / 2] |= v;
+    else out.b[n / 2] = v << 4;
+    n++;
+  }
+  return n == 32 && *s == '\0';
+}
+
+String controlUuidToString(const ControlUuid& id) {
+  static const char hex[] = "0123456789abcdef";
+  char buf[37];
+  int p = 0;
+  for (int i = 0; i < 16; i++) {
+    if (i == 4 || i == 6 || i == 8 || i == 10) buf[p++] = '-';
+    buf[p++] = hex[id.b[i] >> 4];
+    buf[p++] = hex[id.b[i] & 0x0F];
+  }
+  buf[p] = '\0';
+  return String(buf);
+}
+
+bool controlUuidIsNil(const ControlUuid& id) {
+  return id == kNilControlUuid;
+}
+
+size_t ControlStateTable::hashOf(const ControlUuid& id) {
+  // FNV-1a over all 16 bytes; v4 UUIDs are random already but v1/v7 are not
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < 16; i++) { h ^= id.b[i]; h *= 16777619u; }
+  return h & (kCapacity - 1);
+}
+
+const ControlStateTable::Slot* ControlStateTable::find(const ControlUuid& id, unsigned long now) const {
+  size_t i = hashOf(id);
+  for (size_t n = 0; n < kCapacity; n++, i = (i + 1) & (kCapacity - 1)) {
+    const Slot& s = slots_[i];
+    if (s.state == SLOT_EMPTY) return nullptr;
+    if (s.state == SLOT_USED && s.id == id) return expired(s, now) ? nullptr : &s;
+  }
+  return nullptr;
+}
+
+ControlStateTable::Slot* ControlStateTable::findOrInsert(const ControlUuid& id, unsigned long now) {
+  size_t i = hashOf(id);
+  Slot* reuse = nullptr;
+  for (size_t n = 0; n < kCapacity; n++, i = (i + 1) & (kCapacity - 1)) {
+    Slot& s = slots_[i];
+    if (s.state == SLOT_USED && s.id == id) {
+      if (expired(s, now)) { s.deferUntil = 0; s.ackSince = 0; }
+      return &s;
+    }
+    if (!reuse && (s.state == SLOT_DELETED || (s.state == SLOT_USED && expired(s, now)))) reuse = &s;
+    if (s.state == SLOT_EMPTY) {
+      if (!reuse) reuse = &s;
+      break;
+    }
+  }
+  if (!reuse) {
+    // full of live entries: evict whichever expires first
+    reuse = &slots_[0];
+    for (size_t k = 1; k < kCapacity; k++) {
+      if ((int32_t)(slots_[k].expiresAt - reuse->expiresAt) < 0) reuse = &slots_[k];
+    }
+    evictions_++;
+    used_--;
+  } else if (reuse->state == SLOT_USED) {
+    used_--; // reclaiming an expired entry
+  }
+  reuse->id = id;
+  reuse->deferUntil = 0;
+  reuse->ackSince = 0;
+  reuse->expiresAt = (uint32_t)now;
+  reuse->state = SLOT_USED;
+  used_++;
+  return reuse;
+}
+
+void ControlStateTable::refreshExpiry(Slot& s) {
+  uint32_t e = s.expiresAt;
+  if (s.deferUntil && (int32_t)(s.deferUntil - e) > 0) e = s.deferUntil;
+  s.expiresAt = e;
+}
+
+void ControlStateTable::defer(const ControlUuid& id, unsigned long now, unsigned long delayMs) {
+  Slot* s = findOrInsert(id, now);
+  s->deferUntil = (uint32_t)(now + delayMs);
+  if (s->deferUntil == 0) s->deferUntil = 1;
+  refreshExpiry(*s);
+}
+
+bool ControlStateTable::isDeferred(const ControlUuid& id, unsigned long now) const {
+  const Slot* s = find(id, now);
+  return s && s->deferUntil && (int32_t)(s->deferUntil - (uint32_t)now) > 0;
+}
+
+void ControlStateTable::markAwaitingAck(const ControlUuid& id, unsigned long now, unsigned long ttlMs) {
+  Slot* s = findOrInsert(id, now);
+  s->ackSince = (uint32_t)now ? (uint32_t)now : 1;
+  uint32_t until = (uint32_t)(now + ttlMs);
+  if ((int32_t)(until - s->expiresAt) > 0) s->expiresAt = until;
+}
+
+bool ControlStateTable::isAwaitingAck(const ControlUuid& id, unsigned long now) const {
+  const Slot* s = find(id, now);
+  return s && s->ackSince;
+}
+
+unsigned long ControlStateTable::ackReceived(const ControlUuid& id, unsigned long now) {
+  const Slot* cs = find(id, now);
+  if (!cs || !cs->ackSince) return 0;
+  Slot* s = const_cast<Slot*>(cs);
+  unsigned long took = (uint32_t)now - s->ackSince;
+  s->ackSince = 0;
+  if (!(s->deferUntil && (int32_t)(s->deferUntil - (uint32_t)now) > 0)) {
+    s->state = SLOT_DELETED;
+    used_--;
+  }
+  return took ? took : 1;
+}
+
+size_t ControlStateTable::awaitingCount(unsigned long now) const {
+  size_t n = 0;
+  for (size_t i = 0; i < kCapacity; i++) {
+    if (slots_[i].state == SLOT_USED && slots_[i].ackSince && !expired(slots_[i], now)) n++;
+  }
+  return n;
+}
+
+void ControlStateTable::sweep(unsigned long now) {
+  // Rebuild in place: collect live entries, clear, re-insert. 64 slots, no allocation.
+  Slot live[kCapacity];
+  size_t n = 0;
+  for (size_t i = 0; i < kCapacity; i++) {
+    if (slots_[i].state == SLOT_USED && !expired(slots_[i], now)) live[n++] = slots_[i];
+  }
+  memset(slots_, 0, sizeof(slots_));
+  used_ = 0;
+  for (size_t k = 0; k < n; k++) {
+    size_t i = hashOf(live[k].id);
+    while (slots_[i].state != SLOT_EMPTY) i = (i + 1) & (kCapacity - 1);
+    slots_[i] = live[k];
+    used_++;
+  }
+}
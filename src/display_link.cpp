@@ -0,0 +1,234 @@
+#include "display_link.h"
+#include <WiFi.h>
+#include <esp_now.h>
+
+// ---- UART ----
+bool UartTransport::send(const char* line, size_t len, uint16_t seq) {
+  char frame[DisplayLink::kMaxLine + 8];
+  if (len > DisplayLink::kMaxLine) return false;
+  memcpy(frame, line, len);
+  size_t n = len;
+  if (acks_) n += snprintf(frame + n, sizeof(frame) - n, "#%u", (unsigned)seq);
+  frame[n++] = '\n';
+  // never block the caller: a busy lock or a stuck line counts as not sent
+  if (xSemaphoreTake(lock_, (TickType_t)5/portTICK_PERIOD_MS) != pdTRUE) return false;
+  bool sent = (size_t)port_.availableForWrite() >= n && port_.write((const uint8_t*)frame, n) == n;
+  xSemaphoreGive(lock_);
+  return sent;
+}
+
+bool UartTransport::pollResult(uint16_t& seq, bool& ok) {
+  while (port_.available()) {
+    char c = (char)port_.read();
+    if (c == '\r') continue;
+    if (c != '\n') {
+      if (rxLen_ < sizeof(rx_) - 1) rx_[rxLen_++] = c;
+      continue;
+    }
+    rx_[rxLen_] = 0;
+    rxLen_ = 0;
+    if (strncmp(rx_, "ack#", 4) != 0) continue;
+    seq = (uint16_t)atoi(rx_ + 4);
+    ok = true;
+    return seq != 0;
+  }
+  return false;
+}
+
+// ---- ESP-NOW ----
+// The send callback runs in the WiFi task; results are handed over in order through a ring.
+static portMUX_TYPE espNowMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t espNowResults[16];
+static uint8_t espNowHead = 0, espNowCount = 0;
+
+static void onEspNowSent(const uint8_t* mac, esp_now_send_status_t status) {
+  (void)mac;
+  portENTER_CRITICAL(&espNowMux);
+  if (espNowCount < sizeof(espNowResults)) {
+    espNowResults[(espNowHead + espNowCount) % sizeof(espNowResults)] = status == ESP_NOW_SEND_SUCCESS;
+    espNowCount++;
+  }
+  portEXIT_CRITICAL(&espNowMux);
+}
+
+bool EspNowTransport::begin() {
+  if (ready_) return true;
+  esp_err_t r = esp_now_init();
+  if (r != ESP_OK) {
+    Serial.printf("Display: esp_now_init failed: 0x%X\n", (unsigned)r);
+    return false;
+  }
+  esp_now_register_send_cb(onEspNowSent);
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, peer_, 6);
+  peer.channel = 0; // current channel: the display must follow the AP
+  peer.encrypt = false;
+  r = esp_now_add_peer(&peer);
+  if (r != ESP_OK && r != ESP_ERR_ESPNOW_EXIST) {
+    Serial.printf("Display: esp_now_add_peer failed: 0x%X\n", (unsigned)r);
+    return false;
+  }
+  ready_ = true;
+  return true;
+}
+
+bool EspNowTransport::send(const char* line, size_t len, uint16_t seq) {
+  (void)seq;
+  return ready_ && esp_now_send(peer_, (const uint8_t*)line, len) == ESP_OK;
+}
+
+bool EspNowTransport::pollResult(uint16_t& seq, bool& ok) {
+  bool have = false;
+  portENTER_CRITICAL(&espNowMux);
+  if (espNowCount) {
+    ok = espNowResults[espNowHead] != 0;
+    espNowHead = (espNowHead + 1) % sizeof(espNowResults);
+    espNowCount--;
+    have = true;
+  }
+  portEXIT_CRITICAL(&espNowMux);
+  seq = 0;
+  return have;
+}
+
+// ---- Link ----
+DisplayLink::DisplayLink(DisplayTransport* primary, DisplayTransport* secondary) {
+  t_[count_++] = primary;
+  if (secondary) t_[count_++] = secondary;
+}
+
+void DisplayLink::configure(unsigned long ackTimeoutMs, uint8_t failoverAfter, unsigned long failbackMs) {
+  ackTimeoutMs_ = ackTimeoutMs;
+  failoverAfter_ = failoverAfter ? failoverAfter : 1;
+  failbackMs_ = failbackMs;
+}
+
+void DisplayLink::begin() {
+  for (uint8_t i = 0; i < count_; i++) {
+    up_[i] = t_[i]->begin();
+    Serial.printf("Display: %s transport %s\n", t_[i]->name(), up_[i] ? "ready" : "unavailable");
+  }
+  if (!up_[0] && count_ > 1 && up_[1]) active_ = 1;
+}
+
+void DisplayLink::sendOn(uint8_t t, const char* line, unsigned long now, bool resend) {
+  uint16_t seq;
+  int8_t slot = -1;
+  portENTER_CRITICAL(&mux_);
+  seq = ++seq_;
+  if (seq == 0) seq = ++seq_; // 0 means "oldest in flight" in pollResult
+  if (t == active_) { lastSeq_ = seq; lastIsResend_ = resend; }
+  if (t_[t]->confirms()) {
+    // the oldest entry makes room if all are taken; it counts as lost
+    uint8_t oldest = 0;
+    for (uint8_t i = 0; i < kInFlight; i++) {
+      if (!flight_[i].used) { slot = i; break; }
+      if ((long)(flight_[i].sentAt - flight_[oldest].sentAt) < 0) oldest = i;
+    }
+    if (slot < 0) { slot = oldest; stats_[flight_[slot].transport].failed++; }
+    flight_[slot] = { seq, t, true, now };
+  }
+  stats_[t].sent++;
+  portEXIT_CRITICAL(&mux_);
+
+  bool queued = t_[t]->send(line, strlen(line), seq);
+  if (slot < 0) {
+    portENTER_CRITICAL(&mux_);
+    if (queued) stats_[t].unconfirmed++;
+    else stats_[t].failed++;
+    portEXIT_CRITICAL(&mux_);
+  } else if (!queued) {
+    portENTER_CRITICAL(&mux_);
+    settle((uint8_t)slot, false, now);
+    portEXIT_CRITICAL(&mux_);
+  }
+}
+
+void DisplayLink::send(const char* line) {
+  unsigned long now = millis();
+  uint8_t t, mirror = 0xFF;
+  portENTER_CRITICAL(&mux_);
+  strncpy(last_, line, kMaxLine - 1);
+  last_[kMaxLine - 1] = 0;
+  t = active_;
+  // on the fallback, the primary gets a copy once failbackMs passed, to prove it is back
+  if (active_ != 0 && up_[0] && now - switchedAt_ >= failbackMs_) mirror = 0;
+  portEXIT_CRITICAL(&mux_);
+  sendOn(t, line, now, false);
+  if (mirror != 0xFF) sendOn(mirror, line, now, false);
+}
+
+// Caller holds mux_.
+void DisplayLink::settle(uint8_t slot, bool ok, unsigned long now) {
+  Flight& f = flight_[slot];
+  if (!f.used) return;
+  f.used = false;
+  uint8_t t = f.transport;
+  Stats& st = stats_[t];
+  if (ok) {
+    uint32_t ms = now - f.sentAt;
+    st.delivered++;
+    st.totalMs += ms;
+    if (ms > st.maxMs) st.maxMs = ms;
+    if (failRun_[t] > 0) failRun_[t] = 0;
+    // primary proved itself while mirrored: back to it
+    if (t == 0 && active_ != 0 && ++okRun_ >= failoverAfter_) switchTo(0, now, "primary answering again");
+    return;
+  }
+  st.failed++;
+  if (t == 0) okRun_ = 0;
+  if (t != active_) return;
+  if (f.seq == lastSeq_ && !lastIsResend_) resendLast_ = true; // the screen is behind: repeat the newest line once
+  if (++failRun_[t] >= failoverAfter_ && count_ > 1 && up_[1 - t]) switchTo(1 - t, now, "delivery failures");
+}
+
+// Caller holds mux_.
+void DisplayLink::switchTo(uint8_t t, unsigned long now, const char* why) {
+  active_ = t;
+  switchedAt_ = now;
+  failRun_[t] = 0;
+  okRun_ = 0;
+  failovers_++;
+  switchReason_ = why;
+}
+
+void DisplayLink::poll(unsigned long now) {
+  // Read the transports outside the lock (UART reads take the driver's own lock)
+  struct Result { uint8_t t; uint16_t seq; bool ok; };
+  Result results[kInFlight * 2];
+  uint8_t n = 0;
+  for (uint8_t t = 0; t < count_; t++) {
+    uint16_t seq;
+    bool ok;
+    while (n < sizeof(results) / sizeof(results[0]) && t_[t]->pollResult(seq, ok)) results[n++] = { t, seq, ok };
+  }
+
+  portENTER_CRITICAL(&mux_);
+  for (uint8_t r = 0; r < n; r++) {
+    int8_t match = -1;
+    for (uint8_t i = 0; i < kInFlight; i++) {
+      const Flight& f = flight_[i];
+      if (!f.used || f.transport != results[r].t) continue;
+      if (results[r].seq != 0 ? f.seq == results[r].seq
+                              : (match < 0 || (int16_t)(f.seq - flight_[match].seq) < 0)) {
+        match = i;
+        if (results[r].seq != 0) break;
+      }
+    }
+    if (match >= 0) settle((uint8_t)match, results[r].ok, now);
+  }
+  for (uint8_t i = 0; i < kInFlight; i++) {
+    if (flight_[i].used && now - flight_[i].sentAt >= ackTimeoutMs_) settle(i, false, now);
+  }
+  bool resend = resendLast_;
+  resendLast_ = false;
+  const char* why = switchReason_;
+  switchReason_ = nullptr;
+  uint8_t t = active_;
+  char line[kMaxLine];
+  strcpy(line, last_);
+  portEXIT_CRITICAL(&mux_);
+
+  if (why) Serial.printf("Display: now on %s (%s)\n", t_[t]->name(), why);
+  if (resend && line[0]) sendOn(t, line, now, true);
+}
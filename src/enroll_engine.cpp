@@ -0,0 +1,136 @@
+#include "enroll_engine.h"
+
+static const uint8_t kCmdGenImg = 0x01;
+static const uint8_t kCmdImg2Tz = 0x02;
+static const uint8_t kCmdRegModel = 0x05;
+static const uint8_t kCmdStore = 0x06;
+static const uint8_t kAckOk = 0x00;
+static const uint8_t kAckNoFinger = 0x02;
+static const uint8_t kAckTimeout = 0xFF;
+static const unsigned long kAckTimeoutMs = 1000;
+
+void EnrollEngine::begin(uint32_t addr, unsigned long pollMs, unsigned long scanTimeoutMs, DoneFn done) {
+  addr_ = addr;
+  done_ = done;
+  //                                cmd           pollMs  deadlineMs     onDeadline
+  table_[PH_IDLE]        = PhaseSpec{ 0,            0,      0,             RESULT_FAILED };
+  table_[PH_WAIT_FINGER] = PhaseSpec{ kCmdGenImg,   pollMs, scanTimeoutMs, RESULT_TIMEOUT };
+  table_[PH_EXTRACT]     = PhaseSpec{ kCmdImg2Tz,   0,      kAckTimeoutMs, RESULT_FAILED };
+  table_[PH_MERGE]       = PhaseSpec{ kCmdRegModel, 0,      kAckTimeoutMs, RESULT_FAILED };
+  table_[PH_WAIT_LIFT]   = PhaseSpec{ kCmdGenImg,   pollMs, scanTimeoutMs, RESULT_TIMEOUT };
+  table_[PH_STORE]       = PhaseSpec{ kCmdStore,    0,      kAckTimeoutMs, RESULT_FAILED };
+}
+
+bool EnrollEngine::start(int staffid, uint16_t fid, uint8_t captures, unsigned long now) {
+  if (active()) return false;
+  staffid_ = staffid;
+  fid_ = fid;
+  uint8_t most = extraMerges_ ? kMaxCaptures : kMinCaptures;
+  target_ = captures < kMinCaptures ? kMinCaptures : (captures > most ? most : captures);
+  captured_ = 0;
+  lastError_ = 0;
+  commands_ = 0;
+  polls_ = 0;
+  startedAt_ = now;
+  enter(PH_WAIT_FINGER, now);
+  return true;
+}
+
+void EnrollEngine::enter(Phase phase, unsigned long now) {
+  phase_ = phase;
+  phaseAt_ = now;
+  inFlight_ = false;
+  answeredAt_ = now - table_[phase].pollMs; // first command of a phase goes out right away
+}
+
+void EnrollEngine::send(unsigned long now) {
+  uint8_t cmd[4] = { table_[phase_].cmd, 0, 0, 0 };
+  size_t len = 1;
+  switch (phase_) {
+    case PH_EXTRACT: cmd[1] = captured_ == 0 ? 1 : 2; len = 2; break;
+    case PH_STORE:   cmd[1] = 1; cmd[2] = (uint8_t)(fid_ >> 8); cmd[3] = (uint8_t)fid_; len = 4; break;
+    default: break;
+  }
+  while (port_.available()) port_.read(); // drop anything stale before a new command
+  parser_.reset();
+  zfmWriteFrame(port_, addr_, ZFM_PID_COMMAND, cmd, len);
+  inFlight_ = true;
+  sentAt_ = now;
+  commands_++;
+}
+
+EnrollEngine::Event EnrollEngine::finish(Result result) {
+  phase_ = PH_IDLE;
+  inFlight_ = false;
+  if (result == RESULT_FAILED && lastError_ == 0) lastError_ = kAckTimeout;
+  if (done_) done_(result, staffid_, fid_);
+  return EV_DONE;
+}
+
+EnrollEngine::Event EnrollEngine::poll(unsigned long now) {
+  if (phase_ == PH_IDLE) return EV_NONE;
+  const PhaseSpec& spec = table_[phase_];
+
+  if (!inFlight_) {
+    // Only between commands: a GenImg in flight may still report the finger the wait was for.
+    if (now - phaseAt_ >= spec.deadlineMs) return finish(spec.onDeadline);
+    if (now - answeredAt_ < spec.pollMs) return EV_NONE;
+    polls_++;
+    send(now);
+    return EV_NONE;
+  }
+
+  int r = 0;
+  while (r == 0 && port_.available()) r = parser_.feed((uint8_t)port_.read());
+  if (r == 0) {
+    if (now - sentAt_ >= kAckTimeoutMs) return finish(RESULT_FAILED);
+    return EV_NONE;
+  }
+  inFlight_ = false;
+  answeredAt_ = now;
+  if (r < 0 || parser_.pid() != ZFM_PID_ACK || parser_.length() < 1) return finish(RESULT_FAILED);
+  return onAck(parser_.payload()[0], now);
+}
+
+EnrollEngine::Event EnrollEngine::onAck(uint8_t code, unsigned long now) {
+  switch (phase_) {
+    case PH_WAIT_FINGER:
+      // no finger or a smudged image: ask again on the next poll interval
+      if (code == kAckOk) enter(PH_EXTRACT, now);
+      return EV_NONE;
+
+    case PH_EXTRACT:
+      if (code != kAckOk) {
+        lastError_ = code;
+        if (captured_ < 2) return finish(RESULT_FAILED);
+        enter(PH_STORE, now); // CharBuffer1 already holds a merged template
+        return EV_NONE;
+      }
+      captured_++;
+      enter(captured_ >= 2 ? PH_MERGE : PH_WAIT_LIFT, now);
+      return EV_CAPTURED;
+
+    case PH_MERGE:
+      if (code != kAckOk) {
+        lastError_ = code;
+        // an extra capture that does not merge leaves the earlier template in CharBuffer1
+        if (captured_ <= 2) return finish(RESULT_FAILED);
+        enter(PH_STORE, now);
+        return EV_NONE;
+      }
+      enter(captured_ >= target_ ? PH_STORE : PH_WAIT_LIFT, now);
+      return EV_NONE;
+
+    case PH_WAIT_LIFT:
+      if (code != kAckNoFinger) return EV_NONE;
+      enter(PH_WAIT_FINGER, now);
+      return EV_LIFTED;
+
+    case PH_STORE:
+      if (code != kAckOk) { lastError_ = code; return finish(RESULT_FAILED); }
+      return finish(RESULT_STORED);
+
+    default:
+      return finish(RESULT_FAILED);
+  }
+}
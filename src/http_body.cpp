@@ -0,0 +1,248 @@
+#include "http_body.h"
+
+#include <new>
+#include <esp32/rom/miniz.h>
+
+struct HttpBody::Inflater {
+  tinfl_decompressor d;
+  size_t produced;                       // total output, its low bits index the window
+  bool done;
+  uint8_t window[TINFL_LZ_DICT_SIZE];
+};
+
+const size_t HttpBody::kInflateBytes = sizeof(HttpBody::Inflater);
+
+void HttpBody::request(HTTPClient& h, bool allowCompressed, const char* extraHeader) {
+  const char* keys[] = { "Content-Encoding", "Transfer-Encoding", extraHeader };
+  h.collectHeaders(keys, extraHeader ? 3 : 2);
+  h.setReuse(true);
+  // Twice the inflater so the TLS buffers and the JSON document still fit next to it.
+  if (allowCompressed && ESP.getMaxAllocHeap() > 2 * kInflateBytes) h.addHeader("Accept-Encoding", "gzip, deflate");
+}
+
+HttpBody::HttpBody(HTTPClient& h)
+    : HttpBody(h.getStream(), h.header("Content-Encoding"), h.header("Transfer-Encoding"), h.getSize()) {}
+
+HttpBody::HttpBody(Client& src, const String& contentEncoding, const String& transferEncoding, int contentLength)
+    : src_(src) {
+  setTimeout(0); // read() already waits for the connection; -1 means the body ended
+  String te = transferEncoding;
+  te.toLowerCase();
+  chunked_ = te.indexOf("chunked") >= 0;
+  left_ = chunked_ ? 0 : (contentLength >= 0 ? contentLength : -1);
+  String enc = contentEncoding;
+  enc.toLowerCase();
+  if (enc.length() == 0 || enc == "identity") encoding_ = IDENTITY;
+  else if (enc == "gzip" || enc == "x-gzip") encoding_ = GZIP;
+  else if (enc == "deflate") encoding_ = DEFLATE;
+  else encoding_ = UNSUPPORTED;
+
+  if (encoding_ == UNSUPPORTED) {
+    failed_ = true;
+  } else if (encoding_ != IDENTITY) {
+    z_ = new (std::nothrow) Inflater;
+    if (!z_) {
+      failed_ = true;
+    } else {
+      tinfl_init(&z_->d);
+      z_->produced = 0;
+      z_->done = false;
+      if (encoding_ == GZIP && !skipGzipHeader()) failed_ = true;
+    }
+  }
+}
+
+HttpBody::~HttpBody() {
+  delete z_;
+}
+
+const char* HttpBody::encodingName(Encoding e) {
+  switch (e) {
+    case IDENTITY: return "identity";
+    case GZIP: return "gzip";
+    case DEFLATE: return "deflate";
+    default: return "unsupported";
+  }
+}
+
+// Waits up to kReadTimeoutMs for bytes on the connection; false once the server closed it.
+bool HttpBody::waitForSource() {
+  unsigned long t0 = millis();
+  while (src_.available() <= 0) {
+    if (!src_.connected() || millis() - t0 >= kReadTimeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+
+int HttpBody::srcByte() {
+  if (!waitForSource()) return -1;
+  int c = src_.read();
+  if (c >= 0) wire_++;
+  return c;
+}
+
+// Reads the next chunk's size line (RFC 9112 7.1), and the trailer section after the last
+// chunk; false at the end of the body or on bad framing (failed_ then).
+bool HttpBody::nextChunk() {
+  int c;
+  if (!firstChunk_ && (srcByte() != '\r' || srcByte() != '\n')) { failed_ = true; return false; }
+  firstChunk_ = false;
+  uint32_t size = 0;
+  uint8_t digits = 0;
+  while ((c = srcByte()) >= 0 && isxdigit(c)) {
+    if (++digits > 7) { failed_ = true; return false; }
+    size = size << 4 | (uint32_t)(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+  }
+  while (c >= 0 && c != '\n') c = srcByte(); // chunk extensions
+  if (c < 0 || digits == 0) { failed_ = true; return false; }
+  if (size > 0) {
+    left_ = (int32_t)size;
+    return true;
+  }
+  // last chunk: trailer fields up to an empty line
+  for (uint16_t len = 0; (c = srcByte()) >= 0;) {
+    if (c == '\n') {
+      if (len == 0) return false;
+      len = 0;
+    } else if (c != '\r') {
+      len++;
+    }
+  }
+  failed_ = true;
+  return false;
+}
+
+// Next piece of the body, without chunk framing and never past its end.
+bool HttpBody::refillInput() {
+  if (srcEnd_) return false;
+  if (left_ == 0 && (!chunked_ || !nextChunk())) {
+    srcEnd_ = true;
+    return false;
+  }
+  if (!waitForSource()) {
+    srcEnd_ = true;
+    return false;
+  }
+  size_t want = min((size_t)src_.available(), sizeof(in_));
+  if (left_ > 0) want = min(want, (size_t)left_);
+  int n = src_.read(in_, want);
+  if (n <= 0) {
+    srcEnd_ = true;
+    return false;
+  }
+  if (left_ > 0) left_ -= n;
+  inPos_ = 0;
+  inLen_ = (size_t)n;
+  wire_ += (uint32_t)n;
+  return true;
+}
+
+int HttpBody::rawByte() {
+  if (inPos_ == inLen_ && !refillInput()) return -1;
+  return in_[inPos_++];
+}
+
+// RFC 1952 member header; the CRC32/size trailer is not checked (the JSON parse catches
+// truncation) and drain() reads past it.
+bool HttpBody::skipGzipHeader() {
+  uint8_t hdr[10];
+  for (uint8_t i = 0; i < sizeof(hdr); i++) {
+    int c = rawByte();
+    if (c < 0) return false;
+    hdr[i] = (uint8_t)c;
+  }
+  if (hdr[0] != 0x1f || hdr[1] != 0x8b || hdr[2] != 8) return false;
+  uint8_t flags = hdr[3];
+  if (flags & 0x04) { // FEXTRA
+    int lo = rawByte(), hi = rawByte();
+    if (lo < 0 || hi < 0) return false;
+    for (int n = lo | (hi << 8); n > 0; n--) if (rawByte() < 0) return false;
+  }
+  for (uint8_t bit : { (uint8_t)0x08, (uint8_t)0x10 }) { // FNAME, FCOMMENT: zero terminated
+    if (!(flags & bit)) continue;
+    int c;
+    do { c = rawByte(); } while (c > 0);
+    if (c < 0) return false;
+  }
+  if (flags & 0x02) { // FHCRC
+    if (rawByte() < 0 || rawByte() < 0) return false;
+  }
+  return true;
+}
+
+bool HttpBody::inflateMore() {
+  Inflater& z = *z_;
+  while (!z.done && !failed_) {
+    if (inPos_ == inLen_) refillInput();
+    size_t inBytes = inLen_ - inPos_;
+    size_t ofs = z.produced & (TINFL_LZ_DICT_SIZE - 1);
+    size_t outBytes = TINFL_LZ_DICT_SIZE - ofs;
+    mz_uint32 flags = (encoding_ == DEFLATE ? TINFL_FLAG_PARSE_ZLIB_HEADER : 0) |
+                      (srcEnd_ ? 0 : TINFL_FLAG_HAS_MORE_INPUT);
+    tinfl_status st = tinfl_decompress(&z.d, in_ + inPos_, &inBytes, z.window, z.window + ofs, &outBytes, flags);
+    inPos_ += inBytes;
+    z.produced += outBytes;
+    if (st < TINFL_STATUS_DONE || (st == TINFL_STATUS_NEEDS_MORE_INPUT && srcEnd_ && outBytes == 0)) {
+      failed_ = true;
+      return false;
+    }
+    if (st == TINFL_STATUS_DONE) z.done = true;
+    if (outBytes) {
+      out_ = z.window + ofs;
+      outLen_ = outBytes;
+      outPos_ = 0;
+      body_ += (uint32_t)outBytes;
+      return true;
+    }
+  }
+  return false;
+}
+
+int HttpBody::available() {
+  if (z_) return (int)(outLen_ - outPos_);
+  int more = srcEnd_ ? 0 : src_.available();
+  if (left_ >= 0 && more > left_) more = left_; // the rest may be chunk framing
+  return (int)(inLen_ - inPos_) + more;
+}
+
+int HttpBody::read() {
+  if (failed_) return -1;
+  if (!z_) {
+    int c = rawByte();
+    if (c >= 0) body_++;
+    return c;
+  }
+  if (outPos_ == outLen_ && !inflateMore()) return -1;
+  return out_[outPos_++];
+}
+
+int HttpBody::peek() {
+  if (failed_) return -1;
+  if (!z_) {
+    if (inPos_ == inLen_ && !refillInput()) return -1;
+    return in_[inPos_];
+  }
+  if (outPos_ == outLen_ && !inflateMore()) return -1;
+  return out_[outPos_];
+}
+
+bool HttpBody::drain() {
+  if (!failed_ && left_ >= 0) {
+    inPos_ = inLen_;
+    while (refillInput()) inPos_ = inLen_;
+  }
+  if (failed_ || left_ != 0) {
+    src_.stop();
+    return false;
+  }
+  return true;
+}
+
+void BodyStats::note(const HttpBody& b, uint32_t ms) {
+  bodies++;
+  if (b.encoding() != HttpBody::IDENTITY) compressed++;
+  wireBytes += b.wireBytes();
+  jsonBytes += b.bodyBytes();
+  totalMs += ms;
+}
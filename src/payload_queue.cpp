@@ -0,0 +1,74 @@
+#include "payload_queue.h"
+
+PayloadQueue::PushResult PayloadQueue::push(const char* payload) {
+  size_t len = strlen(payload);
+  if (len >= kMaxLen) {
+    overflows_++;
+    return TOO_LONG;
+  }
+  if (contains(payload)) return DUPLICATE;
+  for (uint8_t i = 0; i < kSlots; i++) {
+    Slot& s = slots_[i];
+    if (s.state != SLOT_FREE) continue;
+    memcpy(s.text, payload, len + 1);
+    s.len = (uint16_t)len;
+    s.order = nextOrder_++;
+    s.state = SLOT_QUEUED;
+    return PUSHED;
+  }
+  overflows_++;
+  return FULL;
+}
+
+bool PayloadQueue::contains(const char* payload) const {
+  size_t len = strlen(payload);
+  for (uint8_t i = 0; i < kSlots; i++) {
+    const Slot& s = slots_[i];
+    if (s.state != SLOT_FREE && s.len == len && memcmp(s.text, payload, len) == 0) return true;
+  }
+  return false;
+}
+
+int PayloadQueue::take(char* out, size_t cap) {
+  int oldest = -1;
+  for (uint8_t i = 0; i < kSlots; i++) {
+    if (slots_[i].state != SLOT_QUEUED) continue;
+    if (oldest < 0 || (int32_t)(slots_[i].order - slots_[oldest].order) < 0) oldest = i;
+  }
+  if (oldest < 0 || cap <= slots_[oldest].len) return -1;
+  Slot& s = slots_[oldest];
+  memcpy(out, s.text, s.len + 1);
+  s.state = SLOT_TAKEN;
+  return oldest;
+}
+
+void PayloadQueue::requeue(int slot) {
+  if (slot < 0 || slot >= kSlots || slots_[slot].state != SLOT_TAKEN) return;
+  slots_[slot].order = nextOrder_++;
+  slots_[slot].state = SLOT_QUEUED;
+}
+
+void PayloadQueue::done(int slot) {
+  if (slot < 0 || slot >= kSlots) return;
+  slots_[slot].state = SLOT_FREE;
+}
+
+bool PayloadQueue::replace(int slot, const char* payload) {
+  size_t len = strlen(payload);
+  if (slot < 0 || slot >= kSlots || slots_[slot].state != SLOT_TAKEN || len >= kMaxLen) return false;
+  memcpy(slots_[slot].text, payload, len + 1);
+  slots_[slot].len = (uint16_t)len;
+  return true;
+}
+
+size_t PayloadQueue::queued() const {
+  size_t n = 0;
+  for (uint8_t i = 0; i < kSlots; i++) if (slots_[i].state == SLOT_QUEUED) n++;
+  return n;
+}
+
+size_t PayloadQueue::pending() const {
+  size_t n = 0;
+  for (uint8_t i = 0; i < kSlots; i++) if (slots_[i].state != SLOT_FREE) n++;
+  return n;
+}
@@ -0,0 +1,36 @@
+#include "refresh_validator.h"
+
+bool RefreshValidator::unchanged(const String& token) {
+  refreshes_++;
+  pendingToken_ = token;
+  pendingEtag_ = String();
+  if (token.length() && token == token_) {
+    avoided_++;
+    return true;
+  }
+  return false;
+}
+
+void RefreshValidator::prepare(HTTPClient& h) {
+  if (etag_.length()) h.addHeader("If-None-Match", etag_);
+}
+
+bool RefreshValidator::notModified(HTTPClient& h, int code) {
+  if (code == HTTP_CODE_NOT_MODIFIED) {
+    pendingEtag_ = etag_;
+    avoided_++;
+    return true;
+  }
+  if (code == HTTP_CODE_OK) pendingEtag_ = h.header("ETag");
+  return false;
+}
+
+void RefreshValidator::commit() {
+  token_ = pendingToken_;
+  etag_ = pendingEtag_;
+}
+
+void RefreshValidator::invalidate() {
+  token_ = String();
+  etag_ = String();
+}
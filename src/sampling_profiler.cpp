@@ -0,0 +1,164 @@
+#include "sampling_profiler.h"
+
+#include <new>
+#include <esp_ipc.h>
+
+static_assert((SamplingProfiler::kPcBins & (SamplingProfiler::kPcBins - 1)) == 0, "kPcBins: power of two");
+
+static const uint8_t kFirstTimer = 2; // timer group 1 (both of its timers), one per core
+static SamplingProfiler* activeProfiler = nullptr;
+
+static void IRAM_ATTR sampleCore0() { activeProfiler->sample(0); }
+static void IRAM_ATTR sampleCore1() { activeProfiler->sample(1); }
+
+#if defined(__XTENSA__)
+extern "C" volatile uint32_t port_interruptNesting[]; // FreeRTOS port (port.c)
+#endif
+
+// PC the timer interrupt stopped `task` at, 0 when it interrupted another interrupt. On entry
+// from a task the port saves the exception frame on the task's stack and parks its address in
+// pxTopOfStack, the TCB's first field; the frame's second word is the PC (XT_STK_PC).
+static inline uint32_t IRAM_ATTR interruptedPc(uint8_t core, TaskHandle_t task) {
+#if defined(__XTENSA__)
+  if (port_interruptNesting[core] != 1 || !task) return 0;
+  const uint32_t* frame = *(const uint32_t* const*)task;
+  return frame[1];
+#else
+  (void)core;
+  (void)task;
+  return 0;
+#endif
+}
+
+void IRAM_ATTR SamplingProfiler::sample(uint8_t core) {
+  if (!running_) return;
+  uint32_t t0 = ESP.getCycleCount();
+  Core& c = cores_[core];
+  c.samples++;
+  TaskHandle_t task = xTaskGetCurrentTaskHandleForCPU(core);
+  uint32_t pc = interruptedPc(core, task);
+  if (!pc) {
+    c.inIsr++;
+  } else {
+    pc &= ~((1u << kPcBucketBits) - 1);
+    uint32_t slot = (pc * 2654435761u) >> 23; // top 9 bits of a Fibonacci hash = kPcBins slots
+    uint8_t probe = 0;
+    for (; probe < kProbes; probe++, slot = (slot + 1) & (kPcBins - 1)) {
+      PcBin& b = c.pcs[slot];
+      if (b.pc == pc || b.count == 0) {
+        b.pc = pc;
+        b.count++;
+        break;
+      }
+    }
+    if (probe == kProbes) c.dropped++;
+
+    uint8_t i = 0;
+    for (; i < kTaskBins && c.tasks[i].count && c.tasks[i].handle != task; i++) {}
+    if (i == kTaskBins) {
+      c.otherTasks++;
+    } else {
+      TaskBin& t = c.tasks[i];
+      if (t.count++ == 0) {
+        // the task is running, so its name is there to copy; at dump time it might be gone
+        t.handle = task;
+        const char* name = pcTaskGetName(task);
+        uint8_t n = 0;
+        for (; n < sizeof(t.name) - 1 && name[n]; n++) t.name[n] = name[n];
+        t.name[n] = 0;
+      }
+    }
+  }
+  c.isrCycles += ESP.getCycleCount() - t0;
+}
+
+// The timer's interrupt is allocated on the core that attaches it, so this runs on each core.
+void SamplingProfiler::attachTimer(void* self) {
+  SamplingProfiler* p = static_cast<SamplingProfiler*>(self);
+  uint8_t core = (uint8_t)xPortGetCoreID();
+  hw_timer_t* t = timerBegin(kFirstTimer + core, 80, true); // 1 MHz from the 80 MHz APB clock
+  if (!t) return;
+  timerAttachInterrupt(t, core ? sampleCore1 : sampleCore0, false);
+  p->timers_[core] = t;
+}
+
+bool SamplingProfiler::start(uint32_t hz) {
+  if (hz == 0 || hz > 10000) return false;
+  stop();
+  dumping_ = false;
+  if (!cores_) cores_ = new (std::nothrow) Core[2];
+  if (!cores_) return false;
+  memset(cores_, 0, 2 * sizeof(Core));
+  activeProfiler = this;
+  for (uint8_t core = 0; core < 2; core++) {
+    if (!timers_[core]) esp_ipc_call_blocking(core, attachTimer, this);
+    if (!timers_[core]) return false;
+  }
+  hz_ = hz;
+  startMs_ = millis();
+  elapsedMs_ = 0;
+  running_ = true;
+  for (hw_timer_t* t : timers_) {
+    timerAlarmWrite(t, 1000000 / hz, true);
+    timerAlarmEnable(t);
+  }
+  return true;
+}
+
+void SamplingProfiler::stop() {
+  for (hw_timer_t* t : timers_) {
+    if (t) timerAlarmDisable(t);
+  }
+  if (running_) {
+    running_ = false;
+    elapsedMs_ = millis() - startMs_;
+  }
+}
+
+bool SamplingProfiler::dump(Print& out, uint16_t maxLines) {
+  if (!dumping_) {
+    stop();
+    if (!cores_) {
+      out.println("PROF none (never started)");
+      return false;
+    }
+    dumping_ = true;
+    dumpPos_ = 0;
+  }
+
+  // dumpPos_: 0 = begin line, then per core its summary line, task bins and PC bins, then end
+  const uint32_t perCore = 1 + kTaskBins + kPcBins;
+  const uint32_t endPos = 1 + 2 * perCore;
+  uint16_t lines = 0;
+  while (lines < maxLines && dumpPos_ <= endPos) {
+    uint32_t pos = dumpPos_++;
+    if (pos == 0) {
+      out.printf("PROF begin hz=%lu ms=%lu bucket=%u\n", (unsigned long)hz_, (unsigned long)elapsedMs_,
+                 1u << kPcBucketBits);
+    } else if (pos == endPos) {
+      out.println("PROF end");
+    } else {
+      uint8_t core = (uint8_t)((pos - 1) / perCore);
+      uint32_t i = (pos - 1) % perCore;
+      const Core& c = cores_[core];
+      if (i == 0) {
+        double cycles = (double)elapsedMs_ * getCpuFrequencyMhz() * 1000.0;
+        out.printf("PROF core %u samples=%lu isr=%lu dropped=%lu other_tasks=%lu overhead=%.3f%%\n", core,
+                   (unsigned long)c.samples, (unsigned long)c.inIsr, (unsigned long)c.dropped,
+                   (unsigned long)c.otherTasks, cycles > 0 ? 100.0 * (double)c.isrCycles / cycles : 0.0);
+      } else if (i <= kTaskBins) {
+        const TaskBin& t = c.tasks[i - 1];
+        if (!t.count) continue;
+        out.printf("PROF task %u %lu %s\n", core, (unsigned long)t.count, t.name); // name last: may hold spaces
+      } else {
+        const PcBin& b = c.pcs[i - 1 - kTaskBins];
+        if (!b.count) continue;
+        out.printf("PROF pc %u 0x%08lx %lu\n", core, (unsigned long)b.pc, (unsigned long)b.count);
+      }
+    }
+    lines++;
+  }
+  if (dumpPos_ <= endPos) return true;
+  dumping_ = false;
+  return false;
+}
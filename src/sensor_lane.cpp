@@ -0,0 +1,162 @@
+#include "sensor_lane.h"
+
+static const uint8_t kCmdGenImg = 0x01;
+static const uint8_t kCmdImg2Tz = 0x02;
+static const uint8_t kCmdSearch = 0x04;
+static const uint8_t kCmdHiSpeedSearch = 0x1B;
+static const uint8_t kAckOk = 0x00;
+static const uint8_t kAckNoFinger = 0x02;
+static const uint8_t kAckNotFound = 0x09;
+static const uint8_t kAckTimeout = 0xFF;
+static const unsigned long kAckTimeoutMs = 1000;
+
+const char* SensorLane::outcomeName(Outcome o) {
+  switch (o) {
+    case OUT_MATCH: return "match";
+    case OUT_MATCH_RECAPTURE: return "match after re-capture";
+    case OUT_MATCH_FULL_SEARCH: return "match by full search";
+    case OUT_LOW_SCORE: return "low score";
+    case OUT_MISS: return "miss";
+    case OUT_ERROR: return "error";
+    default: return "?";
+  }
+}
+
+void SensorLane::begin(uint32_t addr, uint16_t capacity, unsigned long pollGapMs) {
+  addr_ = addr;
+  if (capacity) capacity_ = capacity;
+  pollGapMs_ = pollGapMs;
+  step_ = ST_IDLE;
+  inSession_ = false;
+  parser_.reset();
+}
+
+void SensorLane::send(Step step, const uint8_t* cmd, size_t len, unsigned long now) {
+  while (port_.available()) port_.read(); // drop anything stale before a new command
+  parser_.reset();
+  zfmWriteFrame(port_, addr_, ZFM_PID_COMMAND, cmd, len);
+  step_ = step;
+  sentAt_ = now;
+  commands_++;
+}
+
+void SensorLane::sendGenImg(unsigned long now) {
+  lastGenImg_ = now;
+  uint8_t cmd[1] = { kCmdGenImg };
+  send(ST_GETIMAGE, cmd, sizeof(cmd), now);
+}
+
+// Slot ids are sensor pages; page 0 is never enrolled, so the hot range is pages 0..hotSlots.
+void SensorLane::sendSearch(SearchStage stage, unsigned long now) {
+  bool split = hotSlots_ > 0 && hotSlots_ + 1 < capacity_;
+  uint16_t start = 0, count = capacity_;
+  if (stage == SEARCH_HOT && split) count = hotSlots_ + 1;
+  if (stage == SEARCH_COLD) { start = hotSlots_ + 1; count = capacity_ - start; }
+  uint8_t cmd[6] = { stage == SEARCH_FULL ? kCmdSearch : kCmdHiSpeedSearch, 1,
+                     (uint8_t)(start >> 8), (uint8_t)start, (uint8_t)(count >> 8), (uint8_t)count };
+  stage_ = stage;
+  send(ST_SEARCH, cmd, sizeof(cmd), now);
+}
+
+SensorLane::Event SensorLane::resolve(Outcome o, unsigned long now) {
+  step_ = ST_IDLE;
+  inSession_ = false;
+  sessionEnded_ = true;
+  lastOutcome_ = o;
+  OutcomeStats& st = stats_[o];
+  uint32_t ms = now - fingerAt_;
+  st.count++;
+  st.totalMs += ms;
+  if (ms > st.maxMs) st.maxMs = ms;
+  if (o == OUT_ERROR) return EV_ERROR;
+  if (o == OUT_LOW_SCORE || o == OUT_MISS) return EV_NO_MATCH;
+  fid_ = bestFid_;
+  score_ = bestScore_;
+  return EV_MATCH;
+}
+
+SensorLane::Event SensorLane::fail(uint8_t code, unsigned long now) {
+  lastError_ = code;
+  if (inSession_) return resolve(OUT_ERROR, now);
+  step_ = ST_IDLE;
+  return EV_ERROR;
+}
+
+// No more tries: the best hit so far decides
+SensorLane::Event SensorLane::settle(unsigned long now) {
+  if (!haveBest_) return resolve(OUT_MISS, now);
+  return resolve(bestScore_ >= policy_.minScore ? bestVia_ : OUT_LOW_SCORE, now);
+}
+
+SensorLane::Event SensorLane::onHit(uint16_t fid, uint16_t score, bool full, unsigned long now) {
+  if (!haveBest_ || score > bestScore_) {
+    haveBest_ = true;
+    bestFid_ = fid;
+    bestScore_ = score;
+    bestVia_ = full ? OUT_MATCH_FULL_SEARCH : (recaptured_ ? OUT_MATCH_RECAPTURE : OUT_MATCH);
+  }
+  if (bestScore_ >= policy_.acceptScore) return resolve(bestVia_, now);
+  if (recaptured_ >= policy_.maxRecaptures) return settle(now);
+  recaptured_++;
+  recaptures_++;
+  sendGenImg(now); // same session: no poll gap, no hold
+  return EV_NONE;
+}
+
+SensorLane::Event SensorLane::poll(unsigned long now) {
+  sessionEnded_ = false;
+  if (step_ == ST_IDLE) {
+    if (paused_ || (long)(now - holdUntil_) < 0 || now - lastGenImg_ < pollGapMs_) return EV_NONE;
+    sendGenImg(now);
+    return EV_NONE;
+  }
+
+  // Collect the ACK for the command in flight, without waiting for bytes that are not here yet
+  int r = 0;
+  while (r == 0 && port_.available()) r = parser_.feed((uint8_t)port_.read());
+  if (r == 0) {
+    if (now - sentAt_ >= kAckTimeoutMs) return fail(kAckTimeout, now);
+    return EV_NONE;
+  }
+  if (r < 0 || parser_.pid() != ZFM_PID_ACK || parser_.length() < 1) return fail(kAckTimeout, now);
+  const uint8_t* ack = parser_.payload();
+
+  switch (step_) {
+    case ST_GETIMAGE: {
+      if (inSession_ && ack[0] != kAckOk) return settle(now); // lifted during a re-capture
+      if (ack[0] == kAckNoFinger) { step_ = ST_IDLE; return EV_NONE; }
+      if (ack[0] != kAckOk) return fail(ack[0], now);
+      captures_++;
+      uint8_t cmd[2] = { kCmdImg2Tz, 1 };
+      send(ST_IMG2TZ, cmd, sizeof(cmd), now);
+      if (inSession_) return EV_NONE;
+      inSession_ = true;
+      fingerAt_ = now;
+      recaptured_ = 0;
+      haveBest_ = false;
+      return EV_FINGER;
+    }
+    case ST_IMG2TZ: {
+      if (ack[0] != kAckOk) return recaptured_ ? settle(now) : fail(ack[0], now);
+      sendSearch(SEARCH_HOT, now);
+      return EV_NONE;
+    }
+    case ST_SEARCH: {
+      SearchStats& ss = searchStats_[stage_];
+      ss.count++;
+      ss.totalMs += now - sentAt_;
+      if (ack[0] == kAckNotFound) {
+        bool split = hotSlots_ > 0 && hotSlots_ + 1 < capacity_;
+        if (stage_ == SEARCH_HOT && split) { sendSearch(SEARCH_COLD, now); return EV_NONE; }
+        if (stage_ != SEARCH_FULL && policy_.fullSearchOnMiss) { sendSearch(SEARCH_FULL, now); return EV_NONE; }
+        return settle(now);
+      }
+      if (ack[0] != kAckOk || parser_.length() < 5) return fail(ack[0], now);
+      ss.hits++;
+      return onHit(((uint16_t)ack[1] << 8) | ack[2], ((uint16_t)ack[3] << 8) | ack[4], stage_ == SEARCH_FULL, now);
+    }
+    default:
+      step_ = ST_IDLE;
+      return EV_NONE;
+  }
+}
@@ -0,0 +1,97 @@
+#include "served_gossip.h"
+
+static const uint8_t kMagic0 = 'S';
+static const uint8_t kMagic1 = 'G';
+static const uint8_t kVersion = 1;
+// A burst goes out at once, then again after these delays (ms, from the previous send)
+static const unsigned long kRepeatGaps[] = { 20, 30, 50, 400 };
+static const uint8_t kRepeats = sizeof(kRepeatGaps) / sizeof(kRepeatGaps[0]);
+
+static void putU32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t getU32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void ServedGossip::noteLocal(uint32_t dayKey, int staffid, unsigned long now) {
+  if (dayKey != day_) resetDay(dayKey);
+  seq_++;
+  window_[seq_ % kWindow] = staffid;
+  if (windowCount_ < kWindow) windowCount_++;
+  repeatsLeft_ = kRepeats + 1;
+  nextSend_ = now;
+}
+
+size_t ServedGossip::pollSend(unsigned long now, uint8_t* buf, size_t cap) {
+  if (repeatsLeft_ == 0 || (long)(now - nextSend_) < 0 || day_ == 0) return 0;
+  size_t len = kHeaderLen + windowCount_ * 4;
+  if (cap < len) return 0;
+  buf[0] = kMagic0; buf[1] = kMagic1; buf[2] = kVersion; buf[3] = windowCount_;
+  putU32(buf + 4, terminal_);
+  putU32(buf + 8, boot_);
+  putU32(buf + 12, day_);
+  putU32(buf + 16, seq_);
+  uint8_t* p = buf + kHeaderLen;
+  for (uint32_t s = seq_ - windowCount_ + 1; s != seq_ + 1; s++, p += 4) putU32(p, (uint32_t)window_[s % kWindow]);
+  repeatsLeft_--;
+  if (repeatsLeft_) nextSend_ = now + kRepeatGaps[kRepeats - repeatsLeft_];
+  stats_.sent++;
+  return len;
+}
+
+bool ServedGossip::receive(const uint8_t* buf, size_t len, uint32_t dayKey, std::vector<int>& fresh) {
+  if (len < kHeaderLen || buf[0] != kMagic0 || buf[1] != kMagic1 || buf[2] != kVersion ||
+      len != kHeaderLen + (size_t)buf[3] * 4) {
+    stats_.ignored++;
+    return false;
+  }
+  uint32_t terminal = getU32(buf + 4);
+  uint32_t boot = getU32(buf + 8);
+  uint32_t day = getU32(buf + 12);
+  uint32_t lastSeq = getU32(buf + 16);
+  uint8_t count = buf[3];
+  if (terminal == terminal_ || day == 0 || day != dayKey || count == 0 || count > lastSeq) {
+    stats_.ignored++;
+    return false;
+  }
+  if (dayKey != day_) resetDay(dayKey);
+  stats_.received++;
+
+  Peer* peer = nullptr;
+  for (uint8_t i = 0; i < peerCount_; i++) if (peers_[i].terminal == terminal) { peer = &peers_[i]; break; }
+  if (!peer) {
+    uint8_t slot = 0;
+    if (peerCount_ < kMaxPeers) {
+      slot = peerCount_++;
+    } else {
+      // full table: reuse the peer heard from least recently
+      for (uint8_t i = 1; i < kMaxPeers; i++) if (peers_[i].lastRx < peers_[slot].lastRx) slot = i;
+    }
+    peer = &peers_[slot];
+    *peer = { terminal, boot, 0, 0 };
+  }
+  if (peer->boot != boot) *peer = { terminal, boot, 0, 0 }; // sender restarted its sequence
+  peer->lastRx = stats_.received;
+
+  uint32_t firstSeq = lastSeq - count + 1;
+  if (peer->lastSeq != 0 && firstSeq > peer->lastSeq + 1) stats_.gaps += firstSeq - peer->lastSeq - 1;
+  const uint8_t* p = buf + kHeaderLen;
+  for (uint32_t s = firstSeq; s != lastSeq + 1; s++, p += 4) {
+    if (s <= peer->lastSeq) { stats_.duplicates++; continue; }
+    int staffid = (int)getU32(p);
+    fresh.push_back(staffid);
+    remote_.push_back(staffid);
+    stats_.applied++;
+  }
+  if (lastSeq > peer->lastSeq) peer->lastSeq = lastSeq;
+  return true;
+}
+
+void ServedGossip::resetDay(uint32_t dayKey) {
+  day_ = dayKey;
+  windowCount_ = 0;
+  repeatsLeft_ = 0;
+  remote_.clear();
+}
@@ -0,0 +1,274 @@
+#include "staff_directory.h"
+
+#include <algorithm>
+#include <new>
+
+namespace {
+
+uint32_t zigzag(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+int32_t unzigzag(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+
+uint8_t bitWidth(uint32_t v) {
+  uint8_t w = 0;
+  while (v) { w++; v >>= 1; }
+  return w;
+}
+
+size_t putVarint(uint8_t* p, uint32_t v) {
+  size_t n = 0;
+  while (v >= 0x80) { p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+  p[n++] = (uint8_t)v;
+  return n;
+}
+
+const uint8_t* getVarint(const uint8_t* p, uint32_t& v) {
+  v = 0;
+  for (uint8_t shift = 0; shift < 35; shift += 7) {
+    uint8_t b = *p++;
+    v |= (uint32_t)(b & 0x7f) << shift;
+    if (!(b & 0x80)) break;
+  }
+  return p;
+}
+
+// LSB-first bit stream; the writer's buffer must start zeroed.
+struct BitWriter {
+  uint8_t* p;
+  size_t bit = 0;
+  void put(uint32_t v, uint8_t width) {
+    for (uint8_t i = 0; i < width; i++, bit++) {
+      if (v >> i & 1) p[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+    }
+  }
+  size_t bytes() const { return (bit + 7) >> 3; }
+};
+
+// min + offset, wrapping the way the builder's unsigned subtraction did: a block may span
+// more than INT32_MAX.
+int addOffset(int32_t min, uint32_t offset) { return (int)(int32_t)((uint32_t)min + offset); }
+
+uint32_t getBits(const uint8_t* p, size_t bit, uint8_t width) {
+  uint32_t v = 0;
+  for (uint8_t i = 0; i < width; i++, bit++) {
+    v |= (uint32_t)(p[bit >> 3] >> (bit & 7) & 1) << i;
+  }
+  return v;
+}
+
+// Decoded block header: bit widths, minimums and where the packed stream starts.
+struct BlockHeader {
+  uint8_t count, fidWidth, staffWidth, tagWidth;
+  int32_t staffMin, tagMin;
+  const uint8_t* bits;
+};
+
+BlockHeader readHeader(const uint8_t* p) {
+  BlockHeader h;
+  h.count = p[0];
+  h.fidWidth = p[1];
+  h.staffWidth = p[2];
+  h.tagWidth = p[3];
+  uint32_t v;
+  p = getVarint(p + 4, v);
+  h.staffMin = unzigzag(v);
+  p = getVarint(p, v);
+  h.tagMin = unzigzag(v);
+  h.bits = p;
+  return h;
+}
+
+} // namespace
+
+// ---------------- StaffDirectory ----------------
+
+bool StaffDirectory::find(uint32_t fid, StaffRecord& out) const {
+  if (index_.empty() || fid < index_.front().firstFid) return false;
+  // Last block starting at or before fid.
+  size_t lo = 0, hi = index_.size();
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (index_[mid].firstFid <= fid) lo = mid; else hi = mid;
+  }
+  const IndexEntry& e = index_[lo];
+  BlockHeader h = readHeader(segments_[e.segment].get() + e.offset);
+  uint32_t cur = e.firstFid;
+  uint8_t i = 0;
+  size_t bit = 0;
+  while (cur < fid) {
+    if (++i == h.count) return false;
+    cur += getBits(h.bits, bit, h.fidWidth) + 1;
+    bit += h.fidWidth;
+  }
+  if (cur != fid) return false;
+  size_t staffBits = (size_t)(h.count - 1) * h.fidWidth;
+  size_t tagBits = staffBits + (size_t)h.count * h.staffWidth;
+  out.staffid = addOffset(h.staffMin, getBits(h.bits, staffBits + (size_t)i * h.staffWidth, h.staffWidth));
+  out.tag = addOffset(h.tagMin, getBits(h.bits, tagBits + (size_t)i * h.tagWidth, h.tagWidth));
+  return true;
+}
+
+uint8_t StaffDirectory::decodeBlock(size_t block, uint32_t* fids, StaffRecord* recs) const {
+  const IndexEntry& e = index_[block];
+  BlockHeader h = readHeader(segments_[e.segment].get() + e.offset);
+  size_t bit = 0;
+  fids[0] = e.firstFid;
+  for (uint8_t i = 1; i < h.count; i++, bit += h.fidWidth) {
+    fids[i] = fids[i - 1] + getBits(h.bits, bit, h.fidWidth) + 1;
+  }
+  for (uint8_t i = 0; i < h.count; i++, bit += h.staffWidth) {
+    recs[i].staffid = addOffset(h.staffMin, getBits(h.bits, bit, h.staffWidth));
+  }
+  for (uint8_t i = 0; i < h.count; i++, bit += h.tagWidth) {
+    recs[i].tag = addOffset(h.tagMin, getBits(h.bits, bit, h.tagWidth));
+  }
+  return h.count;
+}
+
+void StaffDirectory::clear() {
+  std::vector<IndexEntry>().swap(index_);
+  std::vector<std::unique_ptr<uint8_t[]>>().swap(segments_);
+  segmentUsed_ = 0;
+  count_ = 0;
+  encoded_ = 0;
+}
+
+// ---------------- StaffDirectoryBuilder ----------------
+
+StaffDirectoryBuilder::StaffDirectoryBuilder(size_t expected) {
+  size_t blocks = (expected + StaffDirectory::kBlock - 1) / StaffDirectory::kBlock;
+  if (blocks) dir_.index_.reserve(blocks);
+}
+
+bool StaffDirectoryBuilder::add(uint32_t fid, const StaffRecord& r) {
+  if (failed_) return false;
+  if (n_ > 0 && fid <= fids_[n_ - 1]) {
+    if (fid == fids_[n_ - 1]) { recs_[n_ - 1] = r; return true; }
+    failed_ = true;
+    return false;
+  }
+  if (n_ == StaffDirectory::kBlock && !flush()) return false;
+  fids_[n_] = fid;
+  recs_[n_] = r;
+  n_++;
+  return true;
+}
+
+bool StaffDirectoryBuilder::flush() {
+  if (n_ == 0) return true;
+  int32_t staffMin = recs_[0].staffid, staffMax = staffMin;
+  int32_t tagMin = recs_[0].tag, tagMax = tagMin;
+  uint32_t deltaMax = 0;
+  for (uint8_t i = 0; i < n_; i++) {
+    staffMin = std::min<int32_t>(staffMin, recs_[i].staffid);
+    staffMax = std::max<int32_t>(staffMax, recs_[i].staffid);
+    tagMin = std::min<int32_t>(tagMin, recs_[i].tag);
+    tagMax = std::max<int32_t>(tagMax, recs_[i].tag);
+    if (i > 0) deltaMax = std::max(deltaMax, fids_[i] - fids_[i - 1] - 1);
+  }
+
+  uint8_t block[StaffDirectory::kMaxBlockBytes] = {};
+  block[0] = n_;
+  block[1] = bitWidth(deltaMax);
+  block[2] = bitWidth((uint32_t)staffMax - (uint32_t)staffMin);
+  block[3] = bitWidth((uint32_t)tagMax - (uint32_t)tagMin);
+  size_t len = 4;
+  len += putVarint(block + len, zigzag(staffMin));
+  len += putVarint(block + len, zigzag(tagMin));
+  BitWriter w{block + len};
+  for (uint8_t i = 1; i < n_; i++) w.put(fids_[i] - fids_[i - 1] - 1, block[1]);
+  for (uint8_t i = 0; i < n_; i++) w.put((uint32_t)recs_[i].staffid - (uint32_t)staffMin, block[2]);
+  for (uint8_t i = 0; i < n_; i++) w.put((uint32_t)recs_[i].tag - (uint32_t)tagMin, block[3]);
+  len += w.bytes();
+
+  StaffDirectory& d = dir_;
+  if (d.segments_.empty() || d.segmentUsed_ + len > StaffDirectory::kSegmentBytes) {
+    if (d.segments_.size() == 0xffff) { failed_ = true; return false; }
+    std::unique_ptr<uint8_t[]> seg(new (std::nothrow) uint8_t[StaffDirectory::kSegmentBytes]);
+    if (!seg) { failed_ = true; return false; }
+    d.segments_.push_back(std::move(seg));
+    d.segmentUsed_ = 0;
+  }
+  memcpy(d.segments_.back().get() + d.segmentUsed_, block, len);
+  d.index_.push_back({fids_[0], (uint16_t)(d.segments_.size() - 1), (uint16_t)d.segmentUsed_});
+  d.segmentUsed_ += len;
+  d.count_ += n_;
+  d.encoded_ += len;
+  n_ = 0;
+  return true;
+}
+
+bool StaffDirectoryBuilder::finish(StaffDirectory& out) {
+  if (failed_ || !flush()) return false;
+  dir_.index_.shrink_to_fit();
+  out = std::move(dir_);
+  dir_ = StaffDirectory();
+  return true;
+}
+
+// ---------------- StaffMap ----------------
+
+StaffMap::Change* StaffMap::change(uint32_t fid) {
+  auto it = std::lower_bound(overlay_.begin(), overlay_.end(), fid,
+                             [](const Change& c, uint32_t f) { return c.fid < f; });
+  return (it != overlay_.end() && it->fid == fid) ? &*it : nullptr;
+}
+
+const StaffMap::Change* StaffMap::change(uint32_t fid) const {
+  return const_cast<StaffMap*>(this)->change(fid);
+}
+
+bool StaffMap::find(uint32_t fid, StaffRecord& out) const {
+  if (const Change* c = change(fid)) {
+    if (c->erased) return false;
+    out = c->rec;
+    return true;
+  }
+  return dir_.find(fid, out);
+}
+
+void StaffMap::set(uint32_t fid, const StaffRecord& r) {
+  if (Change* c = change(fid)) {
+    c->rec = r;
+    c->erased = false;
+    return;
+  }
+  auto it = std::lower_bound(overlay_.begin(), overlay_.end(), fid,
+                             [](const Change& c, uint32_t f) { return c.fid < f; });
+  overlay_.insert(it, Change{fid, r, false});
+}
+
+void StaffMap::erase(uint32_t fid) {
+  StaffRecord r;
+  bool inDir = dir_.find(fid, r);
+  auto it = std::lower_bound(overlay_.begin(), overlay_.end(), fid,
+                             [](const Change& c, uint32_t f) { return c.fid < f; });
+  bool hasChange = it != overlay_.end() && it->fid == fid;
+  if (!inDir) {
+    if (hasChange) overlay_.erase(it);
+  } else if (hasChange) {
+    it->erased = true;
+  } else {
+    overlay_.insert(it, Change{fid, r, true});
+  }
+}
+
+size_t StaffMap::size() const {
+  size_t n = dir_.size();
+  StaffRecord r;
+  for (const Change& c : overlay_) {
+    bool inDir = dir_.find(c.fid, r);
+    if (c.erased) { if (inDir) n--; }
+    else if (!inDir) n++;
+  }
+  return n;
+}
+
+void StaffMap::replace(StaffDirectory&& dir) {
+  dir_ = std::move(dir);
+  overlay_.clear();
+}
+
+void StaffMap::clear() {
+  dir_.clear();
+  std::vector<Change>().swap(overlay_);
+}
@@ -0,0 +1,184 @@
+#include "stall_watchdog.h"
+
+#include <esp_system.h>
+#include <esp_timer.h>
+#if defined(__XTENSA__)
+#include <esp_debug_helpers.h>
+#endif
+
+static const uint32_t kRingMagic = 0x31575453; // "STW1"
+
+// Survives esp_restart()/panics/watchdog resets (not power loss), like the time anchor.
+struct StallRing {
+  uint32_t magic;
+  uint32_t boots;
+  uint32_t written;  // records ever written; record n lives in rec[(n - 1) % kRing]
+  StallWatchdog::Record rec[StallWatchdog::kRing];
+};
+RTC_NOINIT_ATTR static StallRing stallRing;
+
+static StallWatchdog::Record& ringRecord(uint32_t seq) {
+  return stallRing.rec[(seq - 1) % StallWatchdog::kRing];
+}
+
+// Return addresses of stage()'s callers. Windowed ABI: the top two bits of a saved PC hold the
+// call size, and the address points past the call instruction.
+static void __attribute__((noinline)) captureBacktrace(uint32_t* pcs, uint8_t n) {
+  memset(pcs, 0, n * sizeof(uint32_t));
+#if defined(__XTENSA__)
+  esp_backtrace_frame_t f;
+  esp_backtrace_get_start(&f.pc, &f.sp, &f.next_pc);
+  if (!esp_backtrace_get_next_frame(&f)) return; // out of captureBacktrace, into stage()
+  for (uint8_t i = 0; i < n; i++) {
+    if (!esp_backtrace_get_next_frame(&f)) break;
+    pcs[i] = ((f.pc & 0x3fffffff) | 0x40000000) - 3;
+    if (!f.next_pc) break;
+  }
+#endif
+}
+
+int8_t StallWatchdog::addTask(const char* name, uint32_t budgetMs) {
+  if (taskCount_ == kTasks) return -1;
+  Watched& w = tasks_[taskCount_];
+  w.name = name;
+  w.budgetMs = budgetMs;
+  w.beatMs = millis();
+  w.stage = "start";
+  w.sleeping = false;
+  w.record = 0;
+  return (int8_t)taskCount_++;
+}
+
+void StallWatchdog::begin(uint32_t checkEveryMs, uint32_t sloTargetMs) {
+  sloTargetMs_ = sloTargetMs;
+  bool kept = stallRing.magic == kRingMagic && esp_reset_reason() != ESP_RST_POWERON &&
+              esp_reset_reason() != ESP_RST_BROWNOUT;
+  if (!kept) {
+    memset(&stallRing, 0, sizeof(stallRing));
+    stallRing.magic = kRingMagic;
+  }
+  boot_ = ++stallRing.boots;
+
+  uint32_t first = stallRing.written > kRing ? stallRing.written - kRing + 1 : 1;
+  if (stallRing.written >= first) {
+    Serial.printf("Stall log: %lu stalls since power-on, last %u kept:\n", (unsigned long)stallRing.written,
+                  (unsigned)(stallRing.written - first + 1));
+  }
+  for (uint32_t seq = first; seq <= stallRing.written; seq++) {
+    Record& r = ringRecord(seq);
+    r.task[sizeof(r.task) - 1] = 0;
+    r.stage[sizeof(r.stage) - 1] = 0;
+    Serial.printf("  boot -%lu: %s in '%s' %s %lu ms (budget %lu), from 0x%08lx 0x%08lx 0x%08lx 0x%08lx\n",
+                  (unsigned long)(boot_ - r.boot), r.task, r.stage, r.open ? "until reset," : "for",
+                  (unsigned long)r.durationMs, (unsigned long)r.budgetMs, (unsigned long)r.pc[0],
+                  (unsigned long)r.pc[1], (unsigned long)r.pc[2], (unsigned long)r.pc[3]);
+    r.open = 0;
+    r.logged = 3;
+  }
+
+  esp_timer_create_args_t args = {};
+  args.callback = [](void* self) { static_cast<StallWatchdog*>(self)->check(millis()); };
+  args.arg = this;
+  args.name = "stallwd";
+  esp_timer_handle_t timer;
+  if (esp_timer_create(&args, &timer) == 0) esp_timer_start_periodic(timer, (uint64_t)checkEveryMs * 1000);
+}
+
+void StallWatchdog::stage(int8_t task, const char* stage) {
+  if (task < 0) return;
+  uint32_t pcs[kFrames];
+  captureBacktrace(pcs, kFrames);
+  uint32_t now = millis();
+  Watched& w = tasks_[task];
+  portENTER_CRITICAL(&mux_);
+  if (w.record && stallRing.written - w.record < kRing) {
+    Record& r = ringRecord(w.record);
+    r.durationMs = now - r.atMs;
+    r.open = 0;
+  }
+  w.record = 0;
+  w.beatMs = now;
+  w.stage = stage;
+  memcpy(w.pc, pcs, sizeof(pcs));
+  w.sleeping = false;
+  portEXIT_CRITICAL(&mux_);
+}
+
+void StallWatchdog::sleep(int8_t task) {
+  if (task < 0) return;
+  stage(task, "sleep");
+  portENTER_CRITICAL(&mux_);
+  tasks_[task].sleeping = true;
+  portEXIT_CRITICAL(&mux_);
+}
+
+void StallWatchdog::check(uint32_t now) {
+  portENTER_CRITICAL(&mux_);
+  for (uint8_t i = 0; i < taskCount_; i++) {
+    Watched& w = tasks_[i];
+    if (w.record) {
+      if (stallRing.written - w.record < kRing) ringRecord(w.record).durationMs = now - w.beatMs;
+      continue;
+    }
+    // signed: a stage() on the other core may have stamped a beat after `now` was read
+    if (w.sleeping || (int32_t)(now - w.beatMs) <= (int32_t)w.budgetMs) continue;
+    uint32_t seq = ++stallRing.written;
+    Record& r = ringRecord(seq);
+    r.boot = boot_;
+    r.atMs = w.beatMs;
+    r.durationMs = now - w.beatMs;
+    r.budgetMs = w.budgetMs;
+    memcpy(r.pc, w.pc, sizeof(r.pc));
+    strncpy(r.task, w.name, sizeof(r.task) - 1);
+    r.task[sizeof(r.task) - 1] = 0;
+    strncpy(r.stage, w.stage, sizeof(r.stage) - 1);
+    r.stage[sizeof(r.stage) - 1] = 0;
+    r.open = 1;
+    r.logged = 0;
+    w.record = seq;
+    hour_.stalls++;
+  }
+  portEXIT_CRITICAL(&mux_);
+}
+
+void StallWatchdog::report() {
+  Record pending[kRing];
+  uint8_t n = 0;
+  portENTER_CRITICAL(&mux_);
+  uint32_t first = stallRing.written > kRing ? stallRing.written - kRing + 1 : 1;
+  for (uint32_t seq = first; seq <= stallRing.written; seq++) {
+    Record& r = ringRecord(seq);
+    if (r.boot != boot_ || r.logged == 3 || (r.open && r.logged)) continue;
+    pending[n++] = r;
+    r.logged = r.open ? 1 : 3;
+  }
+  portEXIT_CRITICAL(&mux_);
+
+  for (uint8_t i = 0; i < n; i++) {
+    const Record& r = pending[i];
+    if (r.logged == 1) {
+      Serial.printf("Stall: %s left '%s' after %lu ms\n", r.task, r.stage, (unsigned long)r.durationMs);
+      continue;
+    }
+    Serial.printf("Stall: %s %s '%s' %lu ms (budget %lu), from 0x%08lx 0x%08lx 0x%08lx 0x%08lx\n",
+                  r.task, r.open ? "stuck in" : "spent in", r.stage, (unsigned long)r.durationMs,
+                  (unsigned long)r.budgetMs, (unsigned long)r.pc[0], (unsigned long)r.pc[1],
+                  (unsigned long)r.pc[2], (unsigned long)r.pc[3]);
+  }
+}
+
+void StallWatchdog::noteAnswer(uint32_t ms) {
+  portENTER_CRITICAL(&mux_);
+  hour_.answered++;
+  if (ms <= sloTargetMs_) hour_.withinTarget++;
+  if (ms > hour_.worstMs) hour_.worstMs = ms;
+  portEXIT_CRITICAL(&mux_);
+}
+
+StallWatchdog::SloHour StallWatchdog::takeHour() {
+  portENTER_CRITICAL(&mux_);
+  SloHour h = hour_;
+  hour_ = {};
+  portEXIT_CRITICAL(&mux_);
+  return h;
+}
@@ -0,0 +1,77 @@
+#include "template_io.h"
+
+static const uint8_t kCharBuffer = 1;
+
+bool TemplateIO::begin() {
+  if (finger_.getParameters() != FINGERPRINT_OK) return false;
+  addr_ = finger_.device_addr;
+  if (finger_.packet_len == 32 || finger_.packet_len == 64 || finger_.packet_len == 128 || finger_.packet_len == 256) {
+    packetLen_ = finger_.packet_len;
+  }
+  return true;
+}
+
+int TemplateIO::readFrame(uint8_t& pid, uint8_t* payload, size_t cap, uint32_t timeoutMs) {
+  parser_.reset();
+  unsigned long start = millis();
+  while (millis() - start < timeoutMs) {
+    if (!port_.available()) { delay(1); continue; }
+    int r = parser_.feed((uint8_t)port_.read());
+    if (r < 0) return -1;
+    if (r == 0) continue;
+    if (parser_.length() > cap) return -1;
+    pid = parser_.pid();
+    memcpy(payload, parser_.payload(), parser_.length());
+    return (int)parser_.length();
+  }
+  return -1;
+}
+
+bool TemplateIO::command(uint8_t code, uint8_t arg) {
+  uint8_t cmd[2] = { code, arg };
+  zfmWriteFrame(port_, addr_, ZFM_PID_COMMAND, cmd, sizeof(cmd));
+  uint8_t ack[4];
+  uint8_t pid = 0;
+  int n = readFrame(pid, ack, sizeof(ack), 1000);
+  return n >= 1 && pid == ZFM_PID_ACK && ack[0] == FINGERPRINT_OK;
+}
+
+bool TemplateIO::slotUsed(uint16_t fid) {
+  return finger_.loadModel(fid, kCharBuffer) == FINGERPRINT_OK;
+}
+
+int TemplateIO::exportSlot(uint16_t fid, uint8_t* out, size_t cap) {
+  if (finger_.loadModel(fid, kCharBuffer) != FINGERPRINT_OK) return -1;
+  if (!command(FINGERPRINT_UPLOAD, kCharBuffer)) return -1;
+  size_t total = 0;
+  for (;;) {
+    uint8_t pid = 0;
+    int n = readFrame(pid, out + total, cap - total, 1000);
+    if (n < 0 || (pid != ZFM_PID_DATA && pid != ZFM_PID_END_DATA)) return -1;
+    total += n;
+    if (pid == ZFM_PID_END_DATA) return (int)total;
+    if (total >= cap) return -1;
+  }
+}
+
+bool TemplateIO::importSlot(uint16_t fid, const uint8_t* data, size_t len) {
+  if (len == 0 || len > kMaxTemplateBytes) return false;
+  if (!command(FINGERPRINT_DOWNLOAD, kCharBuffer)) return false;
+  // the sensor expects full packets of its configured size; the last one is flagged END
+  for (size_t off = 0; off < len; off += packetLen_) {
+    size_t n = len - off < packetLen_ ? len - off : packetLen_;
+    zfmWriteFrame(port_, addr_, off + n >= len ? ZFM_PID_END_DATA : ZFM_PID_DATA, data + off, n);
+  }
+  port_.flush();
+  return finger_.storeModel(fid, kCharBuffer) == FINGERPRINT_OK;
+}
+
+bool TemplateIO::copySlot(uint16_t from, uint16_t to) {
+  static uint8_t buf[kMaxTemplateBytes];
+  int n = exportSlot(from, buf, sizeof(buf));
+  return n > 0 && importSlot(to, buf, (size_t)n);
+}
+
+bool TemplateIO::deleteSlot(uint16_t fid) {
+  return finger_.deleteModel(fid) == FINGERPRINT_OK;
+}
@@ -0,0 +1,276 @@
+#include "time_service.h"
+
+#include <Preferences.h>
+#include <esp_sntp.h>
+#include <esp_system.h>
+
+static const time_t kSecondsPerDay = 24 * 3600;
+static const uint32_t kMinDriftIntervalMs = 10UL * 60000UL;   // shorter gaps are all jitter
+static const uint32_t kPersistMinIntervalMs = 6UL * 3600000UL; // flash wear: drift moves slowly
+static const uint32_t kAnchorMagic = 0x31415446;              // "FTA1"
+
+// Survives esp_restart()/panics (not power loss), as does the IDF system clock itself.
+struct RtcAnchor {
+  uint32_t magic;
+  int64_t  wallMs;
+  float    driftPpm;
+  uint32_t check;      // ~magic ^ low word of wallMs
+};
+RTC_NOINIT_ATTR static RtcAnchor rtcAnchor;
+
+static TimeService* syncTarget = nullptr;
+
+static void onSntpSync(struct timeval* tv) {
+  if (syncTarget && tv) syncTarget->noteSync(*tv);
+}
+
+static int64_t nowWallMs() {
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static uint32_t dayKeyOf(const struct tm& t) {
+  if (t.tm_year + 1900 < 2024) return 0;
+  return (uint32_t)(t.tm_year + 1900) * 10000 + (t.tm_mon + 1) * 100 + t.tm_mday;
+}
+
+// Slow path, also used for the journal's older instants: one localtime_r + strftime.
+static size_t formatIsoSlow(time_t epoch, int ms, char* out, size_t len) {
+  struct tm t; localtime_r(&epoch, &t);
+  char z[8];
+  strftime(z, sizeof(z), "%z", &t); // "+0100"
+  int n = ms >= 0
+    ? snprintf(out, len, "%04d-%02d-%02dT%02d:%02d:%02d.%03d%.3s:%.2s",
+               t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, ms, z, z + 3)
+    : snprintf(out, len, "%04d-%02d-%02dT%02d:%02d:%02d%.3s:%.2s",
+               t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, z, z + 3);
+  return (n > 0 && (size_t)n < len) ? (size_t)n : 0;
+}
+
+// The cached fields for the local day containing `now`.
+struct DayCache {
+  time_t start;
+  uint32_t key;
+  char prefix[12];
+  char offset[7];
+};
+
+// localtime_r/strftime take newlib's locks and walk the TZ rules, so this runs with no
+// spinlock held; tick() swaps the result in.
+static void buildDay(time_t now, bool trusted, DayCache& d) {
+  struct tm t; localtime_r(&now, &t);
+  d.start = now - (t.tm_hour * 3600 + t.tm_min * 60 + t.tm_sec);
+  d.key = trusted ? dayKeyOf(t) : 0;
+  snprintf(d.prefix, sizeof(d.prefix), "%04d-%02d-%02dT", t.tm_year + 1900, t.tm_mon + 1, t.tm_mday);
+  char z[8];
+  strftime(z, sizeof(z), "%z", &t);
+  snprintf(d.offset, sizeof(d.offset), "%.3s:%.2s", z, z + 3);
+}
+
+// NTP can also step the clock backwards, so check both edges of the cached day.
+static bool outsideDay(time_t now, time_t dayStart) {
+  return dayStart == 0 || now < dayStart || now >= dayStart + kSecondsPerDay;
+}
+
+void TimeService::tick() {
+  time_t now = time(nullptr);
+  if (now == lastSecond_) return; // racy read is fine: worst case one extra pass below
+
+  portENTER_CRITICAL(&mux_);
+  bool stale = outsideDay(now, dayStart_);
+  bool trusted = trusted_;
+  portEXIT_CRITICAL(&mux_);
+
+  DayCache day = {};
+  if (stale) buildDay(now, trusted, day);
+
+  uint32_t oldKey = 0, newKey = 0;
+  bool rolled = false;
+  portENTER_CRITICAL(&mux_);
+  stale = outsideDay(now, dayStart_);
+  // not stale any more: another ticking task swapped its copy in first
+  if (stale && day.start != 0 && trusted == trusted_) {
+    oldKey = dayKey_;
+    dayStart_ = day.start;
+    dayKey_ = day.key;
+    memcpy(datePrefix_, day.prefix, sizeof(datePrefix_));
+    memcpy(offset_, day.offset, sizeof(offset_));
+    newKey = dayKey_;
+    rolled = newKey != oldKey && newKey != 0;
+    stale = false;
+  }
+  // still stale: a sync re-anchored the day since the first look; the next call rebuilds it
+  if (!stale && now != lastSecond_) {
+    lastSecond_ = now;
+    if (trusted_) {
+      int sod = (int)(now - dayStart_);
+      int h = sod / 3600, m = (sod / 60) % 60;
+      hhmm_[0] = '0' + h / 10; hhmm_[1] = '0' + h % 10; hhmm_[2] = ':';
+      hhmm_[3] = '0' + m / 10; hhmm_[4] = '0' + m % 10; hhmm_[5] = '\0';
+    }
+  }
+  portEXIT_CRITICAL(&mux_);
+
+  if (rolled && rolloverFn_) rolloverFn_(oldKey, newKey);
+}
+
+size_t TimeService::formatIso(time_t epoch, int ms, char* out, size_t len) {
+  const size_t need = 11 + 8 + (ms >= 0 ? 4 : 0) + 6 + 1;
+  if (len < need) return 0;
+
+  char prefix[12], offset[7];
+  time_t dayStart;
+  portENTER_CRITICAL(&mux_);
+  dayStart = dayStart_;
+  memcpy(prefix, datePrefix_, sizeof(prefix));
+  memcpy(offset, offset_, sizeof(offset));
+  portEXIT_CRITICAL(&mux_);
+
+  if (dayStart == 0 || epoch < dayStart || epoch >= dayStart + kSecondsPerDay) {
+    return formatIsoSlow(epoch, ms, out, len);
+  }
+
+  int sod = (int)(epoch - dayStart);
+  int h = sod / 3600, m = (sod / 60) % 60, s = sod % 60;
+  char* p = out;
+  memcpy(p, prefix, 11); p += 11;
+  *p++ = '0' + h / 10; *p++ = '0' + h % 10; *p++ = ':';
+  *p++ = '0' + m / 10; *p++ = '0' + m % 10; *p++ = ':';
+  *p++ = '0' + s / 10; *p++ = '0' + s % 10;
+  if (ms >= 0) {
+    *p++ = '.';
+    *p++ = '0' + (ms / 100) % 10; *p++ = '0' + (ms / 10) % 10; *p++ = '0' + ms % 10;
+  }
+  memcpy(p, offset, 6); p += 6;
+  *p = '\0';
+  return (size_t)(p - out);
+}
+
+size_t TimeService::formatIsoNow(char* out, size_t len) {
+  tick();
+  struct timeval tv;
+  gettimeofday(&tv, nullptr);
+  return formatIso(tv.tv_sec, (int)(tv.tv_usec / 1000), out, len);
+}
+
+void TimeService::hhmm(char* out) {
+  tick();
+  portENTER_CRITICAL(&mux_);
+  memcpy(out, hhmm_, sizeof(hhmm_));
+  portEXIT_CRITICAL(&mux_);
+}
+
+void TimeService::date(char* out) {
+  tick();
+  portENTER_CRITICAL(&mux_);
+  memcpy(out, datePrefix_, 10);
+  portEXIT_CRITICAL(&mux_);
+  out[10] = '\0';
+}
+
+uint32_t TimeService::dayKey() {
+  tick();
+  return dayKey_; // single aligned word, written under mux_
+}
+
+void TimeService::anchorLocked(int64_t wallMs, uint32_t monoMs) {
+  anchorWallMs_ = wallMs;
+  anchorMono_ = monoMs;
+  anchored_ = true;
+  trusted_ = true;
+  dayStart_ = 0;     // next tick() rebuilds the day with a real dayKey and fires the rollover
+  lastSecond_ = -1;
+  rtcAnchor.magic = kAnchorMagic;
+  rtcAnchor.wallMs = wallMs;
+  rtcAnchor.driftPpm = driftPpm_;
+  rtcAnchor.check = ~kAnchorMagic ^ (uint32_t)wallMs;
+}
+
+void TimeService::begin() {
+  Preferences prefs;
+  if (prefs.begin("fptime", true)) {
+    float ppm = 0;
+    if (prefs.getBytesLength("drift") == sizeof(ppm) && prefs.getBytes("drift", &ppm, sizeof(ppm)) == sizeof(ppm)) {
+      driftPpm_ = ppm;
+      driftValid_ = true;
+    }
+    prefs.end();
+  }
+
+  bool rtcValid = rtcAnchor.magic == kAnchorMagic && rtcAnchor.check == (~kAnchorMagic ^ (uint32_t)rtcAnchor.wallMs);
+  esp_reset_reason_t reason = esp_reset_reason();
+  bool clockKept = reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT && reason != ESP_RST_UNKNOWN;
+  int64_t wallMs = nowWallMs();
+  if (rtcValid && clockKept && wallMs >= rtcAnchor.wallMs) {
+    if (!driftValid_) { driftPpm_ = rtcAnchor.driftPpm; driftValid_ = true; }
+    portENTER_CRITICAL(&mux_);
+    anchorLocked(wallMs, millis());
+    portEXIT_CRITICAL(&mux_);
+    Serial.printf("Time: soft reset, system clock kept (last sync %lld s ago) -> trusted\n",
+                  (long long)((wallMs - rtcAnchor.wallMs) / 1000));
+  } else {
+    if (!rtcValid) rtcAnchor.magic = 0;
+    Serial.println("Time: untrusted until the first NTP sync; scans are stamped with millis()");
+  }
+  if (driftValid_) Serial.printf("Time: drift estimate %.2f ppm\n", driftPpm_);
+
+  syncTarget = this;
+  sntp_set_time_sync_notification_cb(onSntpSync);
+}
+
+void TimeService::noteSync(const struct timeval& tv) {
+  int64_t wallMs = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+  uint32_t mono = millis();
+  bool haveStep = false;
+  int64_t stepMs = 0;
+  float ppm = 0;
+
+  portENTER_CRITICAL(&mux_);
+  if (anchored_) {
+    uint32_t elapsed = mono - anchorMono_;
+    stepMs = wallMs - (anchorWallMs_ + (int64_t)elapsed);
+    haveStep = true;
+    if (elapsed >= kMinDriftIntervalMs) {
+      ppm = (float)((double)stepMs * 1e6 / (double)elapsed);
+      driftPpm_ = driftValid_ ? driftPpm_ * 0.75f + ppm * 0.25f : ppm;
+      driftValid_ = true;
+      driftDirty_ = true;
+    }
+  }
+  bool wasTrusted = trusted_;
+  anchorLocked(wallMs, mono);
+  syncs_++;
+  portEXIT_CRITICAL(&mux_);
+
+  if (!wasTrusted) Serial.println("Time: NTP sync -> trusted");
+  if (haveStep) {
+    Serial.printf("Time: NTP sync #%lu, clock was off by %lld ms, drift %.2f ppm\n",
+                  (unsigned long)syncs_, (long long)stepMs, driftPpm_);
+  }
+}
+
+bool TimeService::wallFromMillis(uint32_t monoMs, time_t& sec, int& ms) {
+  if (!trusted_) return false;
+  portENTER_CRITICAL(&mux_);
+  int64_t wallMs = anchorWallMs_;
+  int32_t delta = (int32_t)(monoMs - anchorMono_); // negative for stamps taken before the anchor
+  float ppm = driftValid_ ? driftPpm_ : 0;
+  portEXIT_CRITICAL(&mux_);
+  wallMs += delta + (int64_t)((double)delta * ppm / 1e6);
+  sec = (time_t)(wallMs / 1000);
+  ms = (int)(wallMs % 1000);
+  return true;
+}
+
+void TimeService::persistIfDue(uint32_t nowMs) {
+  if (!driftDirty_) return;
+  if (lastPersistMs_ != 0 && nowMs - lastPersistMs_ < kPersistMinIntervalMs) return;
+  float ppm = driftPpm_;
+  Preferences prefs;
+  if (!prefs.begin("fptime", false)) return;
+  prefs.putBytes("drift", &ppm, sizeof(ppm));
+  prefs.end();
+  driftDirty_ = false;
+  lastPersistMs_ = nowMs ? nowMs : 1;
+}
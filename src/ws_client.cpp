@@ -0,0 +1,174 @@
+// Minimal WebSocket client — see include/ws_client.h
+#include "ws_client.h"
+#include <esp_system.h>
+
+static const char kB64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static String base64Of16(const uint8_t* in) {
+  String out;
+  for (int i = 0; i < 16; i += 3) {
+    uint32_t v = (uint32_t)in[i] << 16;
+    if (i + 1 < 16) v |= (uint32_t)in[i + 1] << 8;
+    if (i + 2 < 16) v |= in[i + 2];
+    out += kB64[(v >> 18) & 0x3F];
+    out += kB64[(v >> 12) & 0x3F];
+    out += (i + 1 < 16) ? kB64[(v >> 6) & 0x3F] : '=';
+    out += (i + 2 < 16) ? kB64[v & 0x3F] : '=';
+  }
+  return out;
+}
+
+bool WsClient::connect(const char* host, uint16_t port, const String& path, unsigned long timeoutMs) {
+  close();
+  if (!client_.connect(host, port)) {
+    Serial.println("WS: TCP/TLS connect failed");
+    return false;
+  }
+
+  uint8_t nonce[16];
+  for (int i = 0; i < 16; i += 4) {
+    uint32_t r = esp_random();
+    memcpy(nonce + i, &r, 4);
+  }
+  String req = String("GET ") + path + " HTTP/1.1\r\n" +
+               "Host: " + host + "\r\n" +
+               "Upgrade: websocket\r\n" +
+               "Connection: Upgrade\r\n" +
+               "Sec-WebSocket-Key: " + base64Of16(nonce) + "\r\n" +
+               "Sec-WebSocket-Version: 13\r\n\r\n";
+  client_.write((const uint8_t*)req.c_str(), req.length());
+
+  // Status line must be 101; the accept hash is not verified (trusted endpoint, TLS already authenticates)
+  unsigned long start = millis();
+  while (!client_.available() && millis() - start < timeoutMs) delay(10);
+  String status = client_.readStringUntil('\n');
+  if (!status.startsWith("HTTP/1.1 101")) {
+    Serial.printf("WS: upgrade refused: %s\n", status.c_str());
+    close();
+    return false;
+  }
+  while (millis() - start < timeoutMs) {
+    String line = client_.readStringUntil('\n');
+    if (line.length() <= 1) break; // blank line ends the headers
+  }
+  lastRx_ = millis();
+  partial_ = String();
+  return true;
+}
+
+void WsClient::close() {
+  if (client_.connected()) writeFrame(0x8, nullptr, 0);
+  client_.stop();
+  partial_ = String();
+}
+
+bool WsClient::connected() {
+  return client_.connected();
+}
+
+bool WsClient::sendText(const String& text) {
+  return writeFrame(0x1, (const uint8_t*)text.c_str(), text.length());
+}
+
+bool WsClient::writeFrame(uint8_t opcode, const uint8_t* data, size_t len) {
+  uint8_t hdr[14];
+  size_t n = 0;
+  hdr[n++] = 0x80 | opcode; // FIN
+  if (len < 126) {
+    hdr[n++] = 0x80 | (uint8_t)len;
+  } else if (len <= 0xFFFF) {
+    hdr[n++] = 0x80 | 126;
+    hdr[n++] = len >> 8;
+    hdr[n++] = len & 0xFF;
+  } else {
+    return false; // never needed for control traffic
+  }
+  uint32_t maskKey = esp_random();
+  uint8_t mask[4];
+  memcpy(mask, &maskKey, 4);
+  memcpy(hdr + n, mask, 4);
+  n += 4;
+  if (client_.write(hdr, n) != n) return false;
+
+  uint8_t buf[64];
+  size_t off = 0;
+  while (off < len) {
+    size_t chunk = len - off < sizeof(buf) ? len - off : sizeof(buf);
+    for (size_t i = 0; i < chunk; i++) buf[i] = data[off + i] ^ mask[(off + i) & 3];
+    if (client_.write(buf, chunk) != chunk) return false;
+    off += chunk;
+  }
+  return true;
+}
+
+bool WsClient::readExact(uint8_t* buf, size_t len) {
+  return client_.readBytes(buf, len) == len;
+}
+
+int WsClient::poll(String& out) {
+  if (!client_.connected()) return -1;
+  while (client_.available() >= 2) {
+    uint8_t h[2];
+    if (!readExact(h, 2)) return -1;
+    bool fin = h[0] & 0x80;
+    uint8_t opcode = h[0] & 0x0F;
+    bool masked = h[1] & 0x80;
+    uint64_t len = h[1] & 0x7F;
+    if (len == 126) {
+      uint8_t e[2];
+      if (!readExact(e, 2)) return -1;
+      len = ((uint16_t)e[0] << 8) | e[1];
+    } else if (len == 127) {
+      uint8_t e[8];
+      if (!readExact(e, 8)) return -1;
+      len = 0;
+      for (int i = 0; i < 8; i++) len = (len << 8) | e[i];
+    }
+    uint8_t mask[4] = {0, 0, 0, 0};
+    if (masked && !readExact(mask, 4)) return -1;
+    lastRx_ = millis();
+
+    // read (or discard) the payload in small pieces
+    String payload;
+    bool keep = (opcode == 0x1 || opcode == 0x0 || opcode == 0x9) && partial_.length() + len <= kMaxMessage;
+    if (keep) payload.reserve((unsigned)len);
+    uint8_t buf[64];
+    uint64_t left = len, pos = 0;
+    while (left > 0) {
+      size_t chunk = left < sizeof(buf) ? (size_t)left : sizeof(buf);
+      if (!readExact(buf, chunk)) return -1;
+      if (keep) {
+        for (size_t i = 0; i < chunk; i++) buf[i] ^= mask[(pos + i) & 3];
+        payload.concat((const char*)buf, chunk);
+      }
+      pos += chunk;
+      left -= chunk;
+    }
+
+    switch (opcode) {
+      case 0x1: // text
+      case 0x0: // continuation
+        if (!keep) {
+          Serial.println("WS: oversized message dropped");
+          partial_ = String();
+          break;
+        }
+        partial_ += payload;
+        if (fin) {
+          out = partial_;
+          partial_ = String();
+          return 1;
+        }
+        break;
+      case 0x8: // close
+        client_.stop();
+        return -1;
+      case 0x9: // ping -> pong with the same payload
+        writeFrame(0xA, (const uint8_t*)payload.c_str(), payload.length());
+        break;
+      default: // pong / binary: ignored
+        break;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,38 @@
+#include "zfm_frame.h"
+
+void zfmWriteFrame(Stream& port, uint32_t addr, uint8_t pid, const uint8_t* payload, size_t len) {
+  uint8_t hdr[9] = { 0xEF, 0x01, (uint8_t)(addr >> 24), (uint8_t)(addr >> 16), (uint8_t)(addr >> 8),
+                     (uint8_t)addr, pid, (uint8_t)((len + 2) >> 8), (uint8_t)(len + 2) };
+  uint16_t sum = pid + hdr[7] + hdr[8];
+  for (size_t i = 0; i < len; i++) sum += payload[i];
+  uint8_t tail[2] = { (uint8_t)(sum >> 8), (uint8_t)sum };
+  port.write(hdr, sizeof(hdr));
+  if (len) port.write(payload, len);
+  port.write(tail, sizeof(tail));
+}
+
+int ZfmParser::feed(uint8_t b) {
+  if (got_ < sizeof(hdr_)) {
+    if ((got_ == 0 && b != 0xEF) || (got_ == 1 && b != 0x01)) { got_ = 0; return 0; }
+    hdr_[got_++] = b;
+    if (got_ == sizeof(hdr_)) {
+      len_ = ((uint16_t)hdr_[7] << 8) | hdr_[8];
+      if (len_ < 2 || (size_t)(len_ - 2) > kMaxPayload) { got_ = 0; return -1; }
+      sum_ = hdr_[6] + hdr_[7] + hdr_[8];
+    }
+    return 0;
+  }
+  size_t i = got_ - sizeof(hdr_);
+  got_++;
+  if (i < (size_t)(len_ - 2)) {
+    payload_[i] = b;
+    sum_ += b;
+    return 0;
+  }
+  if (i == (size_t)(len_ - 2)) {
+    if (b != (uint8_t)(sum_ >> 8)) { got_ = 0; return -1; }
+    return 0;
+  }
+  got_ = 0;
+  return b == (uint8_t)sum_ ? 1 : -1;
+}
@@ -0,0 +1,29 @@
+-- Enrollment commit in one round trip: the terminal calls
+--   POST /rest/v1/rpc/enroll_commit {"p_staffid":..,"p_fingerprintid":..,"p_control_id":"<uuid>"|null}
+-- and both updates land in the same transaction, or neither does.
+-- An unknown staffid raises P0001, which PostgREST answers with 400: a 404 from this RPC then
+-- only ever means the function is not deployed (PGRST202).
+create or replace function public.enroll_commit(
+  p_staffid integer,
+  p_fingerprintid integer,
+  p_control_id uuid default null
+) returns void
+language plpgsql
+as $$
+begin
+  update public.staff
+     set fingerprintid = p_fingerprintid
+   where staffid = p_staffid;
+  if not found then
+    raise exception 'enroll_commit: staff % not found', p_staffid using errcode = 'P0001';
+  end if;
+
+  if p_control_id is not null then
+    update public.control
+       set processed = true
+     where id = p_control_id;
+  end if;
+end;
+$$;
+
+grant execute on function public.enroll_commit(integer, integer, uuid) to anon, authenticated;
@@ -0,0 +1,42 @@
+-- Sensor template backups, one row per sensor slot. Terminals upsert after each enrollment
+--   POST /rest/v1/fingerprint_templates  (Prefer: resolution=merge-duplicates)
+-- and a terminal whose sensor holds fewer templates than staff.fingerprintid rows pages
+-- through this table by fingerprintid to provision itself.
+-- Templates are biometric data, and the anon key ships in every terminal image and web client,
+-- so it must not read them. Terminals use a "terminal" role for them instead: a long-lived JWT
+-- with {"role":"terminal"}, signed with the project's JWT secret (supabase_terminal_jwt in the
+-- firmware). PostgREST switches to the role named in the token, so authenticator must be able
+-- to assume it.
+do $$
+begin
+  if not exists (select 1 from pg_roles where rolname = 'terminal') then
+    create role terminal nologin;
+  end if;
+end
+$$;
+grant terminal to authenticator;
+grant usage on schema public to terminal;
+
+create table if not exists public.fingerprint_templates (
+  fingerprintid integer primary key,
+  staffid       integer references public.staff (staffid) on delete set null,
+  size          integer not null check (size > 0 and size <= 2048),
+  crc32         bigint  not null,               -- over the raw bytes, checked before import
+  template_b64  text    not null,
+  terminal      text,                           -- MAC of the terminal that uploaded it
+  updated_at    timestamptz not null default now()
+);
+
+create or replace function public.fingerprint_templates_touch() returns trigger
+language plpgsql as $$
+begin
+  new.updated_at := now();
+  return new;
+end;
+$$;
+
+drop trigger if exists fingerprint_templates_touch on public.fingerprint_templates;
+create trigger fingerprint_templates_touch before update on public.fingerprint_templates
+  for each row execute function public.fingerprint_templates_touch();
+
+grant select, insert, update, delete on public.fingerprint_templates to terminal;
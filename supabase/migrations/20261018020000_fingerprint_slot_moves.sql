@@ -0,0 +1,63 @@
+-- Hot slot ordering: a terminal moves a frequent diner's template into a low sensor slot and
+-- commits the new slot number with
+--   POST /rest/v1/rpc/move_fingerprint_slot {"p_from":..,"p_to":..,"p_terminal":"<mac>"}
+-- staff.fingerprintid, the fingerprint_templates row and the move log change in one
+-- transaction. Other terminals page through fingerprint_slot_moves by id and replay the moves
+-- on their own sensors.
+-- An unmapped source slot raises P0001 (400), so a 404 from this RPC only ever means the
+-- function is not deployed (PGRST202).
+create table if not exists public.fingerprint_slot_moves (
+  id          bigserial primary key,
+  from_fid    integer not null,
+  to_fid      integer not null,
+  staffid     integer references public.staff (staffid) on delete set null,
+  terminal    text,                           -- MAC of the terminal that made the move
+  created_at  timestamptz not null default now()
+);
+
+create or replace function public.move_fingerprint_slot(
+  p_from integer,
+  p_to integer,
+  p_terminal text default null
+) returns bigint
+language plpgsql
+as $$
+declare
+  v_staffid integer;
+  v_id bigint;
+begin
+  -- one move at a time across terminals
+  perform pg_advisory_xact_lock(hashtext('move_fingerprint_slot'));
+
+  select staffid into v_staffid from public.staff where fingerprintid = p_from;
+  if v_staffid is null then
+    -- a retry after a lost reply finds the move already made
+    select id into v_id from public.fingerprint_slot_moves
+     where from_fid = p_from and to_fid = p_to order by id desc limit 1;
+    if v_id is not null and exists (select 1 from public.staff where fingerprintid = p_to) then
+      return v_id;
+    end if;
+    raise exception 'move_fingerprint_slot: slot % is not mapped', p_from using errcode = 'P0001';
+  end if;
+  if exists (select 1 from public.staff where fingerprintid = p_to) then
+    raise exception 'move_fingerprint_slot: slot % is taken', p_to using errcode = '23505';
+  end if;
+
+  update public.staff set fingerprintid = p_to where fingerprintid = p_from;
+  delete from public.fingerprint_templates where fingerprintid = p_to;
+  update public.fingerprint_templates set fingerprintid = p_to where fingerprintid = p_from;
+  insert into public.fingerprint_slot_moves (from_fid, to_fid, staffid, terminal)
+  values (p_from, p_to, v_staffid, p_terminal)
+  returning id into v_id;
+  return v_id;
+end;
+$$;
+
+grant select on public.fingerprint_slot_moves to anon, authenticated;
+
+-- move_fingerprint_slot rewrites template rows, so only the terminal role may call it.
+grant select, update on public.staff to terminal;
+grant select, insert on public.fingerprint_slot_moves to terminal;
+grant usage on sequence public.fingerprint_slot_moves_id_seq to terminal;
+revoke execute on function public.move_fingerprint_slot(integer, integer, text) from public, anon, authenticated;
+grant execute on function public.move_fingerprint_slot(integer, integer, text) to terminal;
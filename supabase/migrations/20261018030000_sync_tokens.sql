@@ -0,0 +1,45 @@
+-- Change tokens for the terminal caches. Before re-downloading the staff map or today's
+-- collections a terminal calls
+--   POST /rest/v1/rpc/sync_tokens {"p_since":"<today>T00:00:00"}
+-- and skips the download when the token matches the one its cache was built from.
+--   staff:       count : newest updated_at. An insert or update stamps updated_at; a delete
+--                lowers the count.
+--   collections: count : max(id) : newest updated_at over today's rows. An insert takes a new
+--                highest id (also when a delete keeps the count level), an update stamps
+--                updated_at, a delete lowers the count.
+alter table public.staff add column if not exists updated_at timestamptz not null default now();
+
+create or replace function public.touch_updated_at() returns trigger
+language plpgsql as $$
+begin
+  new.updated_at := now();
+  return new;
+end;
+$$;
+
+drop trigger if exists staff_touch on public.staff;
+create trigger staff_touch before update on public.staff
+  for each row execute function public.touch_updated_at();
+
+alter table public.food_collections add column if not exists updated_at timestamptz not null default now();
+
+drop trigger if exists food_collections_touch on public.food_collections;
+create trigger food_collections_touch before update on public.food_collections
+  for each row execute function public.touch_updated_at();
+
+create index if not exists food_collections_time_collected_idx on public.food_collections (time_collected);
+
+create or replace function public.sync_tokens(p_since timestamptz)
+returns json
+language sql stable
+as $$
+  select json_build_object(
+    'staff', (select count(*) || ':' || coalesce(extract(epoch from max(updated_at))::text, '')
+                from public.staff where fingerprintid is not null),
+    'collections', (select count(*) || ':' || coalesce(max(id)::text, '') || ':'
+                             || coalesce(extract(epoch from max(updated_at))::text, '')
+                      from public.food_collections where time_collected >= p_since)
+  );
+$$;
+
+grant execute on function public.sync_tokens(timestamptz) to anon, authenticated;
@@ -0,0 +1,45 @@
+-- Hourly rollups of served collections. Each terminal counts what it serves per hour and tag
+-- and sends the counters with
+--   POST /rest/v1/rpc/upsert_collection_rollups {"p_terminal":"<mac>","p_rows":[{"hour":..,"tag":..,"served":..}]}
+-- Counts are absolute and only ever grow, so a retried or repeated upload keeps the larger
+-- value instead of adding. Reports read collections_per_hour instead of scanning food_collections.
+-- Keeping the larger count means anyone able to call the upsert could raise any terminal's
+-- figures, so only the terminal role (see 20261018010000_fingerprint_templates) writes rollups;
+-- reports read them with the anon key.
+create table if not exists public.collection_rollups (
+  terminal    text not null,                  -- MAC of the terminal that served
+  hour        timestamptz not null,           -- start of the hour
+  tag         integer not null,               -- -1: served offline before the staff was known
+  served      integer not null,
+  updated_at  timestamptz not null default now(),
+  primary key (terminal, hour, tag)
+);
+
+create index if not exists collection_rollups_hour_idx on public.collection_rollups (hour);
+
+create or replace function public.upsert_collection_rollups(p_terminal text, p_rows jsonb)
+returns integer
+language sql
+as $$
+  with upserted as (
+    insert into public.collection_rollups (terminal, hour, tag, served)
+    select p_terminal, (r->>'hour')::timestamptz, (r->>'tag')::integer, (r->>'served')::integer
+      from jsonb_array_elements(p_rows) as r
+    on conflict (terminal, hour, tag) do update
+      set served = greatest(public.collection_rollups.served, excluded.served),
+          updated_at = now()
+    returning 1
+  )
+  select count(*)::integer from upserted;
+$$;
+
+create or replace view public.collections_per_hour as
+  select hour, tag, sum(served)::integer as served, count(*)::integer as terminals
+    from public.collection_rollups
+   group by hour, tag;
+
+grant select on public.collection_rollups to anon, authenticated;
+grant select on public.collections_per_hour to anon, authenticated;
+grant select, insert, update on public.collection_rollups to terminal;
+revoke execute on function public.upsert_collection_rollups(text, jsonb) from public, anon, authenticated;
+grant execute on function public.upsert_collection_rollups(text, jsonb) to terminal;
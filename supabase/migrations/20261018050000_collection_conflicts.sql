@@ -0,0 +1,27 @@
+-- Offline decisions the server disagreed with during reconciliation. A terminal that served
+-- from its local caches while the link was down posts one row per disputed serve to
+--   POST /rest/v1/collection_conflicts
+-- after the reconciliation pass: a double serve (the staff member was already served today)
+-- or a fid that resolves to no staff member. Rows are for review only; nothing reads them back.
+-- One row per disputed serve: a report whose reply was lost is posted again with
+--   ?on_conflict=terminal,fingerprintid,time_collected,reason  Prefer: resolution=ignore-duplicates
+-- and the unique key below drops the copy (nulls count as equal, so undated rows dedupe too).
+create table if not exists public.collection_conflicts (
+  id              bigserial primary key,
+  staffid         integer,                      -- -1 when the fid resolved to nobody
+  fingerprintid   integer not null,
+  tag             integer,
+  time_collected  timestamptz,                  -- when the terminal served
+  terminal        text,                         -- MAC of the terminal that served
+  reason          text not null check (reason in ('double_serve', 'unknown_fid')),
+  stale_cache     boolean not null default false, -- served from a cache older than offlineCacheFreshMs
+  reported_at     timestamptz not null default now(),
+  constraint collection_conflicts_serve_key
+    unique nulls not distinct (terminal, fingerprintid, time_collected, reason)
+);
+
+create index if not exists collection_conflicts_reported_at_idx on public.collection_conflicts (reported_at);
+
+grant insert on public.collection_conflicts to anon, authenticated;
+grant usage on sequence public.collection_conflicts_id_seq to anon, authenticated;
+grant select on public.collection_conflicts to authenticated;
@@ -0,0 +1,155 @@
+// Host stand-in for the parts of the Arduino-ESP32 core that the firmware's pure modules use, so
+// they build and run under `pio test -e native`. Time is a fake clock: millis() returns
+// native::clockMs, which only delay() and the tests move. Spinlocks are no-ops and mutexes
+// never wait (one thread).
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace native {
+inline unsigned long clockMs = 0;
+}
+
+inline unsigned long millis() { return native::clockMs; }
+inline void delay(unsigned long ms) { native::clockMs += ms; }
+
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_NOINIT_ATTR
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+// FreeRTOS mutexes: always free with one thread.
+typedef uint32_t TickType_t;
+#define portTICK_PERIOD_MS 1
+#define pdTRUE 1
+#define pdFALSE 0
+typedef struct { int taken; } StaticSemaphore_t;
+typedef StaticSemaphore_t* SemaphoreHandle_t;
+inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* buf) { buf->taken = 0; return buf; }
+inline int xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks) {
+  (void)ticks;
+  if (s->taken) return pdFALSE;
+  s->taken = 1;
+  return pdTRUE;
+}
+inline int xSemaphoreGive(SemaphoreHandle_t s) { s->taken = 0; return pdTRUE; }
+
+class String {
+public:
+  String() {}
+  String(const char* s) : s_(s ? s : "") {}
+  String(const std::string& s) : s_(s) {}
+  explicit String(int v) : s_(std::to_string(v)) {}
+  explicit String(unsigned long v) : s_(std::to_string(v)) {}
+
+  size_t length() const { return s_.size(); }
+  const char* c_str() const { return s_.c_str(); }
+  void toLowerCase() { for (char& c : s_) c = (char)tolower((unsigned char)c); }
+  int indexOf(const char* needle) const {
+    size_t i = s_.find(needle);
+    return i == std::string::npos ? -1 : (int)i;
+  }
+  bool operator==(const char* o) const { return s_ == o; }
+  bool operator==(const String& o) const { return s_ == o.s_; }
+  bool operator!=(const char* o) const { return s_ != o; }
+  String& operator+=(const String& o) { s_ += o.s_; return *this; }
+  friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+
+private:
+  std::string s_;
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len) {
+    size_t n = 0;
+    while (n < len && write(buf[n])) n++;
+    return n;
+  }
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+  size_t print(const char* s) { return write(s); }
+  size_t println(const char* s = "") { return write(s) + write("\n"); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char buf[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  virtual void flush() {}
+  void setTimeout(unsigned long ms) { timeout_ = ms; }
+  size_t readBytes(uint8_t* buf, size_t len) {
+    size_t n = 0;
+    for (int c; n < len && (c = read()) >= 0;) buf[n++] = (uint8_t)c;
+    return n;
+  }
+
+protected:
+  unsigned long timeout_ = 1000;
+};
+
+class Client : public Stream {
+public:
+  virtual int read(uint8_t* buf, size_t len) = 0;
+  using Stream::read;
+  virtual uint8_t connected() = 0;
+  virtual void stop() = 0;
+};
+
+class HardwareSerial : public Stream {
+public:
+  virtual int availableForWrite() { return 128; }
+  using Print::write;
+};
+
+// Heap figures the firmware sizes buffers by; tests may change them.
+namespace native {
+inline uint32_t maxAllocHeap = 110 * 1024;
+}
+class EspClass {
+public:
+  uint32_t getMaxAllocHeap() { return native::maxAllocHeap; }
+};
+inline EspClass ESP;
+
+// The log: stdout, so a failing test shows what the module said, and native::serialLog for
+// tests that check it.
+namespace native {
+inline std::string serialLog;
+}
+class NativeSerial : public HardwareSerial {
+public:
+  size_t write(uint8_t b) override {
+    native::serialLog += (char)b;
+    return fputc(b, stdout) == EOF ? 0 : 1;
+  }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+};
+inline NativeSerial Serial;
@@ -0,0 +1,40 @@
+// Host stand-in for <HTTPClient.h>: records what HttpBody::request() asks for and serves the
+// reply headers a test sets, over a Client the test provides.
+#pragma once
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+#include <string>
+
+class HTTPClient {
+public:
+  explicit HTTPClient(Client* stream = nullptr) : stream_(stream) {}
+
+  void collectHeaders(const char* keys[], size_t count) {
+    collected.clear();
+    for (size_t i = 0; i < count; i++) collected.push_back(keys[i]);
+  }
+  void addHeader(const String& name, const String& value) { sent[name.c_str()] = value.c_str(); }
+  void setReuse(bool reuse) { this->reuse = reuse; }
+  void useHTTP10(bool http10 = true) { this->http10 = http10; }
+
+  String header(const char* name) {
+    auto it = replyHeaders.find(name);
+    return it == replyHeaders.end() ? String() : String(it->second);
+  }
+  int getSize() { return size; }
+  Client& getStream() { return *stream_; }
+
+  // What the request asked for
+  std::vector<std::string> collected;
+  std::map<std::string, std::string> sent;
+  bool reuse = true;
+  bool http10 = false;
+  // The reply
+  std::map<std::string, std::string> replyHeaders;
+  int size = -1;
+
+private:
+  Client* stream_;
+};
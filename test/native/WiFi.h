@@ -0,0 +1,4 @@
+// Host stand-in for <WiFi.h>: nothing the tested modules call, only so their includes resolve.
+#pragma once
+
+#include <Arduino.h>
@@ -0,0 +1,53 @@
+// Host stand-in for the ESP32 ROM's miniz inflater: the tinfl_* calls HttpBody makes, carried
+// out by the host's zlib (link with -lz). The output buffer is the caller's circular
+// dictionary; zlib keeps its own window, so it only ever writes at next_out.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zlib.h>
+
+typedef uint32_t mz_uint32;
+
+#define TINFL_LZ_DICT_SIZE 32768
+#define TINFL_FLAG_PARSE_ZLIB_HEADER 1
+#define TINFL_FLAG_HAS_MORE_INPUT 2
+
+typedef enum {
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+struct tinfl_decompressor {
+  z_stream z;
+  bool started = false;
+  ~tinfl_decompressor() { if (started) inflateEnd(&z); }
+};
+
+inline void tinfl_init(tinfl_decompressor* d) {
+  if (d->started) inflateEnd(&d->z);
+  d->started = false;
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* d, const uint8_t* in, size_t* inSize, uint8_t* outStart,
+                                     uint8_t* outNext, size_t* outSize, mz_uint32 flags) {
+  (void)outStart;
+  if (!d->started) {
+    d->z = z_stream();
+    if (inflateInit2(&d->z, flags & TINFL_FLAG_PARSE_ZLIB_HEADER ? 15 : -15) != Z_OK) return TINFL_STATUS_FAILED;
+    d->started = true;
+  }
+  d->z.next_in = const_cast<uint8_t*>(in);
+  d->z.avail_in = (uInt)*inSize;
+  d->z.next_out = outNext;
+  d->z.avail_out = (uInt)*outSize;
+  int r = inflate(&d->z, Z_NO_FLUSH);
+  *inSize -= d->z.avail_in;
+  *outSize -= d->z.avail_out;
+  if (r == Z_STREAM_END) return TINFL_STATUS_DONE;
+  if (r != Z_OK && r != Z_BUF_ERROR) return TINFL_STATUS_FAILED;
+  if (d->z.avail_out == 0) return TINFL_STATUS_HAS_MORE_OUTPUT;
+  return (flags & TINFL_FLAG_HAS_MORE_INPUT) ? TINFL_STATUS_NEEDS_MORE_INPUT : TINFL_STATUS_FAILED;
+}
@@ -0,0 +1,27 @@
+// Host stand-in for <esp_now.h>: ESP-NOW is never up under `pio test -e native`, so init fails
+// and EspNowTransport reports itself unavailable.
+#pragma once
+
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_ESPNOW_EXIST 0x306A
+
+typedef enum { ESP_NOW_SEND_SUCCESS = 0, ESP_NOW_SEND_FAIL } esp_now_send_status_t;
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac, esp_now_send_status_t status);
+
+typedef struct {
+  uint8_t peer_addr[6];
+  uint8_t channel;
+  bool encrypt;
+} esp_now_peer_info_t;
+
+inline esp_err_t esp_now_init() { return ESP_FAIL; }
+inline esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb) { (void)cb; return ESP_OK; }
+inline esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) { (void)peer; return ESP_FAIL; }
+inline esp_err_t esp_now_send(const uint8_t* mac, const uint8_t* data, size_t len) {
+  (void)mac; (void)data; (void)len;
+  return ESP_FAIL;
+}
@@ -0,0 +1,26 @@
+// Host stand-in for <esp_system.h>: the reset reason is whatever the test says the last
+// reboot was. RTC_NOINIT memory is ordinary memory here, so it survives a "reboot" (a new
+// instance calling begin()) the way it survives a watchdog reset on the chip.
+#pragma once
+
+#include <Arduino.h>
+
+typedef enum {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO,
+} esp_reset_reason_t;
+
+namespace native {
+inline esp_reset_reason_t resetReason = ESP_RST_POWERON;
+}
+
+inline esp_reset_reason_t esp_reset_reason() { return native::resetReason; }
@@ -0,0 +1,31 @@
+// Host stand-in for <esp_timer.h>: timers never run on their own; the last one started is kept
+// so a test can fire it.
+#pragma once
+
+#include <Arduino.h>
+
+typedef void (*esp_timer_cb_t)(void* arg);
+typedef struct esp_timer* esp_timer_handle_t;
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void* arg;
+  const char* name;
+} esp_timer_create_args_t;
+
+namespace native {
+inline esp_timer_create_args_t timer = {};
+inline uint64_t timerPeriodUs = 0;
+inline void fireTimer() { if (timer.callback) timer.callback(timer.arg); }
+}
+
+inline int esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out) {
+  native::timer = *args;
+  *out = nullptr;
+  return 0;
+}
+inline int esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+  (void)timer;
+  native::timerPeriodUs = periodUs;
+  return 0;
+}
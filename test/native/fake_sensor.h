@@ -0,0 +1,83 @@
+// A scripted ZFM sensor on a Stream, for the capture lane and enrollment tests. The code under
+// test writes command frames; each complete frame is logged and answered with the next
+// scripted ACK, which becomes readable `latencyMs` later on the fake clock. A command with no
+// script left gets no answer, like a sensor that stopped talking.
+#pragma once
+
+#include <Arduino.h>
+#include <deque>
+#include <vector>
+#include "zfm_frame.h"
+
+class FakeSensor : public Stream {
+public:
+  struct Command { uint8_t code; std::vector<uint8_t> args; unsigned long at; };
+
+  unsigned long latencyMs = 0;
+
+  // The next command gets an ACK carrying `code` followed by `extra`.
+  void answer(uint8_t code, std::vector<uint8_t> extra = {}) {
+    extra.insert(extra.begin(), code);
+    script_.push_back(extra);
+  }
+  // Search hit: fid and score as the sensor reports them.
+  void answerHit(uint16_t fid, uint16_t score) {
+    answer(0x00, { (uint8_t)(fid >> 8), (uint8_t)fid, (uint8_t)(score >> 8), (uint8_t)score });
+  }
+  size_t scriptLeft() const { return script_.size(); }
+
+  const std::vector<Command>& commands() const { return log_; }
+  std::vector<uint8_t> codes() const {
+    std::vector<uint8_t> out;
+    for (const Command& c : log_) out.push_back(c.code);
+    return out;
+  }
+
+  int available() override { return due() ? (int)(rx_.size() - rxPos_) : 0; }
+  int read() override { return due() && rxPos_ < rx_.size() ? rx_[rxPos_++] : -1; }
+  int peek() override { return due() && rxPos_ < rx_.size() ? rx_[rxPos_] : -1; }
+
+  size_t write(uint8_t b) override {
+    int r = parser_.feed(b);
+    if (r == 1 && parser_.pid() == ZFM_PID_COMMAND && parser_.length() >= 1) onCommand();
+    return 1;
+  }
+  using Print::write;
+
+private:
+  // Reply bytes are held back until the sensor would have sent them.
+  bool due() const { return (long)(millis() - replyAt_) >= 0; }
+
+  void onCommand() {
+    const uint8_t* p = parser_.payload();
+    log_.push_back({ p[0], std::vector<uint8_t>(p + 1, p + parser_.length()), millis() });
+    if (script_.empty()) return;
+    std::vector<uint8_t> ack = script_.front();
+    script_.pop_front();
+    rx_.erase(rx_.begin(), rx_.begin() + rxPos_);
+    rxPos_ = 0;
+    Sink sink(rx_);
+    zfmWriteFrame(sink, 0xFFFFFFFF, ZFM_PID_ACK, ack.data(), ack.size());
+    replyAt_ = millis() + latencyMs;
+  }
+
+  class Sink : public Stream {
+  public:
+    explicit Sink(std::vector<uint8_t>& out) : out_(out) {}
+    size_t write(uint8_t b) override { out_.push_back(b); return 1; }
+    using Print::write;
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+
+  private:
+    std::vector<uint8_t>& out_;
+  };
+
+  ZfmParser parser_;
+  std::deque<std::vector<uint8_t>> script_;
+  std::vector<Command> log_;
+  std::vector<uint8_t> rx_;
+  size_t rxPos_ = 0;
+  unsigned long replyAt_ = 0;
+};
@@ -0,0 +1,60 @@
+// In-memory display for the DisplayLink tests: keeps the last line shown, confirms each line
+// latencyMs after it was sent (on the fake clock) and drops one line in every lossEvery
+// (0 = none; 1 = all). A down transport refuses lines outright.
+#pragma once
+
+#include "display_link.h"
+
+class LoopbackTransport : public DisplayTransport {
+public:
+  LoopbackTransport(unsigned long latencyMs, uint32_t lossEvery) : latencyMs_(latencyMs), lossEvery_(lossEvery) {}
+  const char* name() const override { return "loopback"; }
+  bool begin() override { return true; }
+  bool confirms() const override { return true; }
+
+  bool send(const char* line, size_t len, uint16_t seq) override {
+    if (down_ || count_ == kQueue) return false;
+    Pending& p = q_[(head_ + count_) % kQueue];
+    p.seq = seq;
+    p.at = millis() + latencyMs_;
+    p.ok = !(lossEvery_ && ++sent_ % lossEvery_ == 0);
+    size_t n = len < sizeof(p.line) - 1 ? len : sizeof(p.line) - 1;
+    memcpy(p.line, line, n);
+    p.line[n] = 0;
+    count_++;
+    received_++;
+    return true;
+  }
+
+  bool pollResult(uint16_t& seq, bool& ok) override {
+    while (count_ > 0) {
+      Pending& p = q_[head_];
+      if ((long)(millis() - p.at) < 0) return false;
+      head_ = (head_ + 1) % kQueue;
+      count_--;
+      if (!p.ok) continue; // a lost line is never confirmed: the link times it out
+      strcpy(shown_, p.line);
+      seq = p.seq;
+      ok = true;
+      return true;
+    }
+    return false;
+  }
+
+  const char* shown() const { return shown_; }
+  uint32_t received() const { return received_; }
+  void setDown(bool down) { down_ = down; }
+  void setLossEvery(uint32_t lossEvery) { lossEvery_ = lossEvery; sent_ = 0; }
+
+private:
+  static const uint8_t kQueue = 8;
+  struct Pending { uint16_t seq; unsigned long at; bool ok; char line[48]; };
+  Pending q_[kQueue];
+  uint8_t head_ = 0, count_ = 0;
+  unsigned long latencyMs_;
+  uint32_t lossEvery_;
+  uint32_t sent_ = 0;
+  uint32_t received_ = 0;
+  bool down_ = false;
+  char shown_[48] = {};
+};
@@ -0,0 +1,172 @@
+// DisplayLink over two in-memory transports: delivery and timing, failover after a run of
+// lost lines with the newest line repeated on the fallback, failback once the primary answers
+// the mirrored copies, and the UART framing (one write per line).
+#include <unity.h>
+
+#include <string>
+#include <vector>
+
+#include "display_link.h"
+#include "loopback_transport.h"
+
+static const unsigned long kAckTimeoutMs = 150, kFailbackMs = 1000;
+static const uint8_t kFailoverAfter = 3;
+
+static LoopbackTransport* primary;
+static LoopbackTransport* fallback;
+static DisplayLink* link;
+
+void setUp() {
+  native::clockMs = 1000;
+  primary = new LoopbackTransport(20, 0);
+  fallback = new LoopbackTransport(5, 0);
+  link = new DisplayLink(primary, fallback);
+  link->configure(kAckTimeoutMs, kFailoverAfter, kFailbackMs);
+  link->begin();
+}
+
+void tearDown() {
+  delete link;
+  delete fallback;
+  delete primary;
+}
+
+static void runFor(unsigned long ms) {
+  for (unsigned long i = 0; i < ms; i++) {
+    native::clockMs++;
+    link->poll(millis());
+  }
+}
+
+void test_line_is_delivered_and_timed() {
+  link->send("successful|12:30");
+  runFor(50);
+  TEST_ASSERT_EQUAL_STRING("successful|12:30", primary->shown());
+  const DisplayLink::Stats& st = link->stats(0);
+  TEST_ASSERT_EQUAL(1, st.sent);
+  TEST_ASSERT_EQUAL(1, st.delivered);
+  TEST_ASSERT_EQUAL(20, st.maxMs);
+  TEST_ASSERT_EQUAL(0, fallback->received());
+}
+
+void test_lost_lines_fail_over_and_repeat_the_newest() {
+  primary->setLossEvery(1);
+  for (int i = 0; i < kFailoverAfter; i++) {
+    char line[16];
+    snprintf(line, sizeof(line), "line%d|12:3%d", i, i);
+    link->send(line);
+    runFor(kAckTimeoutMs + 10);
+  }
+  TEST_ASSERT_EQUAL(1, link->active());
+  TEST_ASSERT_EQUAL(1, link->failovers());
+  runFor(20);
+  // the screen was behind: the fallback got the newest line without a new send()
+  TEST_ASSERT_EQUAL_STRING("line2|12:32", fallback->shown());
+  TEST_ASSERT_EQUAL(kFailoverAfter, link->stats(0).failed);
+}
+
+void test_refused_line_counts_as_failure_at_once() {
+  primary->setDown(true);
+  for (int i = 0; i < kFailoverAfter; i++) {
+    link->send("denied|12:30");
+    runFor(1);
+  }
+  TEST_ASSERT_EQUAL(1, link->active());
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("denied|12:30", fallback->shown());
+}
+
+void test_primary_is_mirrored_and_taken_back() {
+  primary->setLossEvery(1);
+  for (int i = 0; i < kFailoverAfter; i++) {
+    link->send("a|12:30");
+    runFor(kAckTimeoutMs + 10);
+  }
+  TEST_ASSERT_EQUAL(1, link->active());
+
+  // before failbackMs the primary gets no copies
+  primary->setLossEvery(0);
+  uint32_t before = primary->received();
+  link->send("b|12:31");
+  runFor(50);
+  TEST_ASSERT_EQUAL(before, primary->received());
+
+  runFor(kFailbackMs);
+  for (int i = 0; i < kFailoverAfter; i++) {
+    link->send("c|12:32");
+    runFor(50);
+  }
+  TEST_ASSERT_EQUAL(0, link->active());
+  TEST_ASSERT_EQUAL(2, link->failovers());
+  TEST_ASSERT_EQUAL_STRING("c|12:32", primary->shown());
+}
+
+void test_single_transport_never_switches() {
+  LoopbackTransport only(10, 1);
+  DisplayLink alone(&only, nullptr);
+  alone.configure(kAckTimeoutMs, kFailoverAfter, kFailbackMs);
+  alone.begin();
+  for (int i = 0; i < 5; i++) {
+    alone.send("x|12:30");
+    for (unsigned long t = 0; t < kAckTimeoutMs + 10; t++) alone.poll(++native::clockMs);
+  }
+  TEST_ASSERT_EQUAL(0, alone.active());
+  TEST_ASSERT_EQUAL(0, alone.failovers());
+}
+
+// Records each write() call, to check a frame is handed to the UART in one piece.
+class CapturePort : public HardwareSerial {
+public:
+  std::vector<std::string> writes;
+  std::string rx;
+  size_t write(uint8_t b) override { writes.push_back(std::string(1, (char)b)); return 1; }
+  size_t write(const uint8_t* buf, size_t len) override {
+    writes.push_back(std::string((const char*)buf, len));
+    return len;
+  }
+  using Print::write;
+  int available() override { return (int)rx.size(); }
+  int read() override {
+    if (rx.empty()) return -1;
+    int c = (uint8_t)rx[0];
+    rx.erase(0, 1);
+    return c;
+  }
+  int peek() override { return rx.empty() ? -1 : (uint8_t)rx[0]; }
+};
+
+void test_uart_frame_is_one_write() {
+  CapturePort port;
+  UartTransport uart(port, true);
+  TEST_ASSERT_TRUE(uart.send("successful|12:30", 16, 42));
+  TEST_ASSERT_EQUAL(1, port.writes.size());
+  TEST_ASSERT_EQUAL_STRING("successful|12:30#42\n", port.writes[0].c_str());
+
+  port.rx = "noise\r\nack#42\r\n";
+  uint16_t seq = 0;
+  bool ok = false;
+  TEST_ASSERT_TRUE(uart.pollResult(seq, ok));
+  TEST_ASSERT_EQUAL(42, seq);
+  TEST_ASSERT_TRUE(ok);
+}
+
+void test_uart_without_acks_sends_plain_lines() {
+  CapturePort port;
+  UartTransport uart(port, false);
+  TEST_ASSERT_TRUE(uart.send("denied|12:30", 12, 7));
+  TEST_ASSERT_EQUAL(1, port.writes.size());
+  TEST_ASSERT_EQUAL_STRING("denied|12:30\n", port.writes[0].c_str());
+  TEST_ASSERT_FALSE(uart.confirms());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_line_is_delivered_and_timed);
+  RUN_TEST(test_lost_lines_fail_over_and_repeat_the_newest);
+  RUN_TEST(test_refused_line_counts_as_failure_at_once);
+  RUN_TEST(test_primary_is_mirrored_and_taken_back);
+  RUN_TEST(test_single_transport_never_switches);
+  RUN_TEST(test_uart_frame_is_one_write);
+  RUN_TEST(test_uart_without_acks_sends_plain_lines);
+  return UNITY_END();
+}
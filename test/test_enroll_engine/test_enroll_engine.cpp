@@ -0,0 +1,167 @@
+// EnrollEngine against a scripted sensor: the capture/merge/store sequence for 2 captures,
+// extra captures only when allowed (and then a rejected extra merge), poll pacing measured from
+// the reply, and a deadline that does not cut off a GenImg still in flight.
+#include <unity.h>
+
+#include "enroll_engine.h"
+#include "fake_sensor.h"
+
+static const uint8_t kGenImg = 0x01, kImg2Tz = 0x02, kRegModel = 0x05, kStore = 0x06;
+static const uint8_t kOk = 0x00, kNoFinger = 0x02, kMergeFail = 0x0A;
+static const unsigned long kPollMs = 100, kScanTimeoutMs = 10000;
+
+static FakeSensor* sensor;
+static EnrollEngine* engine;
+static int doneCalls;
+static EnrollEngine::Result doneResult;
+
+static void onDone(EnrollEngine::Result result, int staffid, int fid) {
+  (void)staffid;
+  (void)fid;
+  doneCalls++;
+  doneResult = result;
+}
+
+void setUp() {
+  native::clockMs = 5000;
+  doneCalls = 0;
+  sensor = new FakeSensor();
+  engine = new EnrollEngine(*sensor);
+  engine->begin(0xFFFFFFFF, kPollMs, kScanTimeoutMs, onDone);
+}
+
+void tearDown() {
+  delete engine;
+  delete sensor;
+}
+
+// Polls every millisecond until the enrollment ends or maxMs passed.
+static void runToEnd(unsigned long maxMs = 60000) {
+  for (unsigned long i = 0; i < maxMs && engine->active(); i++) {
+    engine->poll(millis());
+    native::clockMs++;
+  }
+}
+
+// One finger placed and lifted: GenImg, Img2Tz, [RegModel], then GenImg until lifted.
+static void scriptCapture(bool merge, bool lift) {
+  sensor->answer(kOk);               // GenImg
+  sensor->answer(kOk);               // Img2Tz
+  if (merge) sensor->answer(kOk);    // RegModel
+  if (lift) sensor->answer(kNoFinger);
+}
+
+void test_two_captures_store() {
+  scriptCapture(false, true);
+  scriptCapture(true, false);
+  sensor->answer(kOk);               // Store
+  TEST_ASSERT_TRUE(engine->start(42, 17, 2, millis()));
+  runToEnd();
+  TEST_ASSERT_EQUAL(1, doneCalls);
+  TEST_ASSERT_EQUAL(EnrollEngine::RESULT_STORED, doneResult);
+  TEST_ASSERT_EQUAL(2, engine->captured());
+
+  std::vector<uint8_t> codes = sensor->codes();
+  uint8_t want[] = { kGenImg, kImg2Tz, kGenImg, kGenImg, kImg2Tz, kRegModel, kStore };
+  TEST_ASSERT_EQUAL(sizeof(want), codes.size());
+  TEST_ASSERT_EQUAL_MEMORY(want, codes.data(), sizeof(want));
+  // second capture into CharBuffer2, stored as page 17 from buffer 1
+  TEST_ASSERT_EQUAL(2, sensor->commands()[4].args[0]);
+  uint8_t store[] = { 1, 0, 17 };
+  TEST_ASSERT_EQUAL_MEMORY(store, sensor->commands().back().args.data(), sizeof(store));
+}
+
+void test_extra_captures_need_the_flag() {
+  scriptCapture(false, true);
+  scriptCapture(true, false);
+  sensor->answer(kOk);               // Store
+  engine->start(42, 17, 4, millis());
+  runToEnd();
+  TEST_ASSERT_EQUAL(EnrollEngine::RESULT_STORED, doneResult);
+  TEST_ASSERT_EQUAL(2, engine->captured());
+  int merges = 0;
+  for (uint8_t c : sensor->codes()) merges += c == kRegModel;
+  TEST_ASSERT_EQUAL(1, merges);
+}
+
+void test_four_captures_merge_three_times() {
+  engine->allowExtraMerges(true);
+  scriptCapture(false, true);
+  scriptCapture(true, true);
+  scriptCapture(true, true);
+  scriptCapture(true, false);
+  sensor->answer(kOk);
+  engine->start(42, 17, 4, millis());
+  runToEnd();
+  TEST_ASSERT_EQUAL(EnrollEngine::RESULT_STORED, doneResult);
+  TEST_ASSERT_EQUAL(4, engine->captured());
+  int merges = 0;
+  for (uint8_t c : sensor->codes()) merges += c == kRegModel;
+  TEST_ASSERT_EQUAL(3, merges);
+}
+
+void test_rejected_extra_merge_stores_what_was_built() {
+  engine->allowExtraMerges(true);
+  scriptCapture(false, true);
+  scriptCapture(true, true);
+  sensor->answer(kOk);               // third GenImg
+  sensor->answer(kOk);               // Img2Tz
+  sensor->answer(kMergeFail);        // RegModel refuses the third capture
+  sensor->answer(kOk);               // Store
+  engine->start(42, 17, 3, millis());
+  runToEnd();
+  TEST_ASSERT_EQUAL(EnrollEngine::RESULT_STORED, doneResult);
+  TEST_ASSERT_EQUAL(kMergeFail, engine->lastError());
+  TEST_ASSERT_EQUAL(kStore, sensor->codes().back());
+}
+
+void test_wait_polls_are_paced_from_the_reply() {
+  sensor->latencyMs = 60;            // the sensor's own GenImg time
+  for (int i = 0; i < 10; i++) sensor->answer(kNoFinger);
+  engine->start(42, 17, 2, millis());
+  for (int i = 0; i < 1600 && sensor->commands().size() < 10; i++) {
+    engine->poll(millis());
+    native::clockMs++;
+  }
+  const std::vector<FakeSensor::Command>& cmds = sensor->commands();
+  TEST_ASSERT_EQUAL(10, cmds.size());
+  for (size_t i = 1; i < cmds.size(); i++) {
+    // reply after 60 ms, then the 100 ms gap: one GenImg per ~160 ms, ~375 a minute
+    TEST_ASSERT_GREATER_OR_EQUAL(kPollMs + 60, cmds[i].at - cmds[i - 1].at);
+    TEST_ASSERT_LESS_OR_EQUAL(kPollMs + 62, cmds[i].at - cmds[i - 1].at);
+  }
+}
+
+void test_deadline_waits_for_the_genimg_in_flight() {
+  sensor->latencyMs = 200;
+  for (int i = 0; i < 200; i++) sensor->answer(kNoFinger);
+  engine->start(42, 17, 2, millis());
+  unsigned long started = millis();
+  runToEnd(kScanTimeoutMs + 1000);
+  TEST_ASSERT_EQUAL(1, doneCalls);
+  TEST_ASSERT_EQUAL(EnrollEngine::RESULT_TIMEOUT, doneResult);
+  // the last GenImg was answered before the timeout was taken
+  const FakeSensor::Command& last = sensor->commands().back();
+  TEST_ASSERT_GREATER_OR_EQUAL(last.at + 200, millis() - 1);
+  TEST_ASSERT_GREATER_OR_EQUAL(started + kScanTimeoutMs, millis() - 1);
+}
+
+void test_silent_sensor_fails_after_the_ack_timeout() {
+  engine->start(42, 17, 2, millis());
+  runToEnd();
+  TEST_ASSERT_EQUAL(EnrollEngine::RESULT_FAILED, doneResult);
+  TEST_ASSERT_EQUAL(0xFF, engine->lastError());
+  TEST_ASSERT_EQUAL(1, sensor->commands().size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_two_captures_store);
+  RUN_TEST(test_extra_captures_need_the_flag);
+  RUN_TEST(test_four_captures_merge_three_times);
+  RUN_TEST(test_rejected_extra_merge_stores_what_was_built);
+  RUN_TEST(test_wait_polls_are_paced_from_the_reply);
+  RUN_TEST(test_deadline_waits_for_the_genimg_in_flight);
+  RUN_TEST(test_silent_sensor_fails_after_the_ack_timeout);
+  return UNITY_END();
+}
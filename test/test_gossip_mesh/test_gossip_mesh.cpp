@@ -0,0 +1,120 @@
+// ServedGossip across a simulated canteen LAN: kTerminals instances serving at random, every
+// packet multicast to the others through a seeded network that drops and delays each copy on
+// its own. Checks that every serve reaches every peer and that the p99 delay from a serve to
+// a peer applying it stays under 100 ms, the budget for a diner walking to the next line.
+#include <unity.h>
+
+#include <algorithm>
+#include <random>
+
+#include "served_gossip.h"
+
+static const uint32_t kDay = 20261018;
+static const int kTerminals = 4;
+static const unsigned long kRunMs = 10UL * 60 * 1000;
+static const unsigned long kDrainMs = 2000;      // past the last repeat of the last burst
+static const unsigned long kMinDelayMs = 3, kMaxDelayMs = 18;
+static const unsigned long kBudgetMs = 100;
+
+struct InFlight {
+  unsigned long due;
+  int to;
+  size_t len;
+  uint8_t bytes[ServedGossip::kMaxPacket];
+};
+
+struct MeshResult {
+  int serves = 0;
+  std::vector<unsigned long> delays;  // one per (serve, peer) that applied it
+  uint32_t gaps = 0;
+};
+
+// Runs the mesh for kRunMs on a 1 ms tick. Each terminal serves with probability
+// servePerTenThousand per tick; each copy of a packet is lost with lossPct percent and otherwise
+// arrives kMinDelayMs..kMaxDelayMs later. Staffids are unique per serve so arrivals can be timed.
+static MeshResult runMesh(uint32_t seed, unsigned lossPct, unsigned servePerTenThousand) {
+  std::mt19937 rng(seed);
+  ServedGossip nodes[kTerminals];
+  for (int i = 0; i < kTerminals; i++) nodes[i].begin(0x100 + i, 1);
+  std::vector<unsigned long> servedAt;  // by staffid - kFirstStaff
+  const int kFirstStaff = 1000;
+  std::vector<InFlight> net;
+  std::vector<int> fresh;
+  uint8_t buf[ServedGossip::kMaxPacket];
+  MeshResult r;
+
+  for (unsigned long now = 1; now < kRunMs + kDrainMs; now++) {
+    for (int i = 0; i < kTerminals; i++) {
+      if (now < kRunMs && rng() % 10000 < servePerTenThousand) {
+        nodes[i].noteLocal(kDay, kFirstStaff + (int)servedAt.size(), now);
+        servedAt.push_back(now);
+      }
+      size_t len = nodes[i].pollSend(now, buf, sizeof(buf));
+      if (!len) continue;
+      for (int to = 0; to < kTerminals; to++) {
+        if (to == i || rng() % 100 < lossPct) continue;
+        InFlight f;
+        f.due = now + kMinDelayMs + rng() % (kMaxDelayMs - kMinDelayMs + 1);
+        f.to = to;
+        f.len = len;
+        memcpy(f.bytes, buf, len);
+        net.push_back(f);
+      }
+    }
+    for (size_t k = 0; k < net.size();) {
+      if (net[k].due != now) { k++; continue; }
+      fresh.clear();
+      TEST_ASSERT_TRUE(nodes[net[k].to].receive(net[k].bytes, net[k].len, kDay, fresh));
+      for (int sid : fresh) r.delays.push_back(now - servedAt[sid - kFirstStaff]);
+      net[k] = net.back();
+      net.pop_back();
+    }
+  }
+  r.serves = (int)servedAt.size();
+  for (int i = 0; i < kTerminals; i++) r.gaps += nodes[i].stats().gaps;
+  return r;
+}
+
+static unsigned long percentile(std::vector<unsigned long> v, int pct) {
+  std::sort(v.begin(), v.end());
+  return v[(v.size() - 1) * pct / 100];
+}
+
+static void checkMesh(const MeshResult& r) {
+  TEST_ASSERT_GREATER_THAN(100, r.serves);
+  // every serve applied once on every other terminal, none given up as a gap
+  TEST_ASSERT_EQUAL(r.serves * (kTerminals - 1), r.delays.size());
+  TEST_ASSERT_EQUAL(0, r.gaps);
+  TEST_ASSERT_LESS_THAN(kBudgetMs, percentile(r.delays, 99));
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_light_loss_meets_budget() {
+  checkMesh(runMesh(1, 5, 4));
+}
+
+void test_heavy_loss_meets_budget() {
+  checkMesh(runMesh(2, 20, 4));
+}
+
+void test_rush_hour_heavy_loss_meets_budget() {
+  // about one serve a second per line: bursts overlap, the 8-event window carries them
+  checkMesh(runMesh(3, 20, 10));
+}
+
+void test_lossless_is_one_hop() {
+  MeshResult r = runMesh(4, 0, 4);
+  TEST_ASSERT_EQUAL(r.serves * (kTerminals - 1), r.delays.size());
+  TEST_ASSERT_LESS_OR_EQUAL(kMaxDelayMs + 1, *std::max_element(r.delays.begin(), r.delays.end()));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_light_loss_meets_budget);
+  RUN_TEST(test_heavy_loss_meets_budget);
+  RUN_TEST(test_rush_hour_heavy_loss_meets_budget);
+  RUN_TEST(test_lossless_is_one_hop);
+  return UNITY_END();
+}
@@ -0,0 +1,229 @@
+// HttpBody over a scripted keep-alive connection: identity, gzip and deflate bodies, with
+// Content-Length or chunked framing, read to their end without waiting for the server to close,
+// and drained so the next response on the connection is untouched.
+#include <unity.h>
+
+#include <string>
+#include <zlib.h>
+#include "http_body.h"
+
+// Bytes the server sent; they arrive `piece` at a time and the connection stays open.
+class FakeConnection : public Client {
+public:
+  std::string data;
+  size_t pos = 0;
+  size_t piece = 7;
+  bool open = true;
+  bool stopped = false;
+
+  int available() override { return (int)std::min(piece, data.size() - pos); }
+  int read() override { return pos < data.size() ? (uint8_t)data[pos++] : -1; }
+  int read(uint8_t* buf, size_t len) override {
+    size_t n = std::min(len, (size_t)available());
+    memcpy(buf, data.data() + pos, n);
+    pos += n;
+    return (int)n;
+  }
+  int peek() override { return pos < data.size() ? (uint8_t)data[pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+  uint8_t connected() override { return open; }
+  void stop() override { stopped = true; open = false; }
+  std::string rest() const { return data.substr(pos); }
+};
+
+static const char* kNext = "HTTP/1.1 200 OK\r\n";
+
+// A fingerprint map page as PostgREST returns it.
+static std::string staffPage(int rows) {
+  std::string json = "[";
+  for (int i = 0; i < rows; i++) {
+    char row[96];
+    snprintf(row, sizeof(row), "%s{\"staffid\":%d,\"fingerprintid\":%d,\"tag\":%d}", i ? "," : "",
+             100000 + (i * 7919) % 900000, 1 + i * 2, i % 3);
+    json += row;
+  }
+  return json + "]";
+}
+
+// windowBits 31 = gzip wrapper, 15 = zlib ("deflate" in HTTP)
+static std::string compress(const std::string& in, int windowBits) {
+  z_stream z = {};
+  TEST_ASSERT_EQUAL(Z_OK, deflateInit2(&z, 6, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY));
+  std::string out(deflateBound(&z, in.size()) + 32, '\0');
+  z.next_in = (Bytef*)in.data();
+  z.avail_in = (uInt)in.size();
+  z.next_out = (Bytef*)&out[0];
+  z.avail_out = (uInt)out.size();
+  TEST_ASSERT_EQUAL(Z_STREAM_END, deflate(&z, Z_FINISH));
+  out.resize(z.total_out);
+  deflateEnd(&z);
+  return out;
+}
+
+static std::string chunked(const std::string& body, size_t chunk) {
+  std::string out;
+  for (size_t i = 0; i < body.size(); i += chunk) {
+    size_t n = std::min(chunk, body.size() - i);
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", n);
+    out += size + body.substr(i, n) + "\r\n";
+  }
+  return out + "0\r\n\r\n";
+}
+
+static std::string readAll(HttpBody& body) {
+  std::string out;
+  for (int c; (c = body.read()) >= 0;) out += (char)c;
+  return out;
+}
+
+void setUp() { native::clockMs = 1000; }
+void tearDown() {}
+
+// Reads `wire` as a body with the given headers; checks the JSON, that nothing waited for the
+// server to close, and that drain() left the next response in place.
+static void expectBody(const std::string& wire, const char* encoding, bool isChunked, const std::string& json) {
+  FakeConnection conn;
+  conn.data = wire + kNext;
+  HttpBody body(conn, encoding, isChunked ? "chunked" : "", isChunked ? -1 : (int)wire.size());
+  TEST_ASSERT_TRUE(readAll(body) == json);
+  TEST_ASSERT_TRUE(body.ok());
+  TEST_ASSERT_TRUE(body.drain());
+  TEST_ASSERT_EQUAL_STRING(kNext, conn.rest().c_str());
+  TEST_ASSERT_FALSE(conn.stopped);
+  TEST_ASSERT_LESS_THAN(HttpBody::kReadTimeoutMs, millis() - 1000);
+  TEST_ASSERT_EQUAL(json.size(), body.bodyBytes());
+  TEST_ASSERT_EQUAL(wire.size(), body.wireBytes());
+}
+
+void test_identity_with_length() {
+  std::string json = staffPage(20);
+  expectBody(json, "", false, json);
+}
+
+void test_identity_chunked() {
+  std::string json = staffPage(20);
+  expectBody(chunked(json, 100), "", true, json);
+}
+
+void test_gzip_with_length() {
+  std::string json = staffPage(250);
+  expectBody(compress(json, 31), "gzip", false, json);
+}
+
+void test_gzip_chunked() {
+  std::string json = staffPage(250);
+  expectBody(chunked(compress(json, 31), 333), "gzip", true, json);
+}
+
+void test_deflate_chunked() {
+  std::string json = staffPage(250);
+  expectBody(chunked(compress(json, 15), 64), "deflate", true, json);
+}
+
+void test_chunk_extensions_and_trailers() {
+  std::string wire = "5;name=x\r\n[1,2,\r\n3\r\n3]\n\r\n0\r\nDigest: x\r\n\r\n";
+  expectBody(wire, "", true, "[1,2,3]\n");
+}
+
+void test_drain_after_parser_stops_early() {
+  FakeConnection conn;
+  std::string json = staffPage(250);
+  std::string wire = chunked(compress(json, 31), 200);
+  conn.data = wire + kNext;
+  HttpBody body(conn, "gzip", "chunked", -1);
+  for (int i = 0; i < 10; i++) body.read(); // the parser stops after the closing bracket
+  TEST_ASSERT_TRUE(body.drain());
+  TEST_ASSERT_EQUAL_STRING(kNext, conn.rest().c_str());
+}
+
+void test_corrupt_body_closes_the_connection() {
+  FakeConnection conn;
+  std::string gz = compress(staffPage(50), 31);
+  gz[20] ^= 0x55;
+  gz[21] ^= 0x55;
+  conn.data = gz + kNext;
+  HttpBody body(conn, "gzip", "", (int)gz.size());
+  readAll(body);
+  TEST_ASSERT_FALSE(body.ok());
+  TEST_ASSERT_FALSE(body.drain());
+  TEST_ASSERT_TRUE(conn.stopped);
+}
+
+void test_bad_chunk_size_fails() {
+  FakeConnection conn;
+  conn.data = std::string("zz\r\nhello\r\n0\r\n\r\n") + kNext;
+  HttpBody body(conn, "", "chunked", -1);
+  TEST_ASSERT_EQUAL(-1, body.read());
+  TEST_ASSERT_FALSE(body.drain());
+  TEST_ASSERT_TRUE(conn.stopped);
+}
+
+void test_body_without_length_ends_at_close() {
+  FakeConnection conn;
+  conn.data = "[1]";
+  conn.open = false; // the server closed after sending it
+  HttpBody body(conn, "", "", -1);
+  TEST_ASSERT_TRUE(readAll(body) == "[1]");
+  TEST_ASSERT_FALSE(body.drain());
+}
+
+void test_request_keeps_http11_and_asks_for_compression() {
+  FakeConnection conn;
+  HTTPClient h(&conn);
+  h.http10 = false;
+  HttpBody::request(h, true, "ETag");
+  TEST_ASSERT_FALSE(h.http10);
+  TEST_ASSERT_TRUE(h.reuse);
+  TEST_ASSERT_EQUAL(3, h.collected.size());
+  TEST_ASSERT_EQUAL_STRING("Transfer-Encoding", h.collected[1].c_str());
+  TEST_ASSERT_EQUAL_STRING("gzip, deflate", h.sent["Accept-Encoding"].c_str());
+
+  HTTPClient small(&conn);
+  native::maxAllocHeap = HttpBody::kInflateBytes;
+  HttpBody::request(small, true);
+  native::maxAllocHeap = 110 * 1024;
+  TEST_ASSERT_EQUAL(0, small.sent.count("Accept-Encoding"));
+}
+
+void test_http_client_constructor_reads_reply_headers() {
+  FakeConnection conn;
+  std::string json = staffPage(5);
+  conn.data = chunked(json, 16) + kNext;
+  HTTPClient h(&conn);
+  h.replyHeaders["Transfer-Encoding"] = "chunked";
+  HttpBody body(h);
+  TEST_ASSERT_TRUE(readAll(body) == json);
+  TEST_ASSERT_TRUE(body.drain());
+}
+
+// Not a check: the wire cost of one staffPageSize (250 row) page, and host inflate time.
+// A full map page shrinks to under a third of its JSON and comes back intact at TCP segment size.
+void test_gzip_page_is_under_a_third() {
+  std::string json = staffPage(250);
+  std::string gz = compress(json, 31);
+  TEST_ASSERT_LESS_THAN(json.size() / 3, gz.size());
+  FakeConnection conn;
+  conn.piece = 1460;
+  conn.data = gz;
+  HttpBody body(conn, "gzip", "", (int)gz.size());
+  TEST_ASSERT_TRUE(readAll(body) == json);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_identity_with_length);
+  RUN_TEST(test_identity_chunked);
+  RUN_TEST(test_gzip_with_length);
+  RUN_TEST(test_gzip_chunked);
+  RUN_TEST(test_deflate_chunked);
+  RUN_TEST(test_chunk_extensions_and_trailers);
+  RUN_TEST(test_drain_after_parser_stops_early);
+  RUN_TEST(test_corrupt_body_closes_the_connection);
+  RUN_TEST(test_bad_chunk_size_fails);
+  RUN_TEST(test_body_without_length_ends_at_close);
+  RUN_TEST(test_request_keeps_http11_and_asks_for_compression);
+  RUN_TEST(test_http_client_constructor_reads_reply_headers);
+  RUN_TEST(test_gzip_page_is_under_a_third);
+  return UNITY_END();
+}
@@ -0,0 +1,160 @@
+// SensorLane against a scripted sensor: the command sequence of a scan session, the split
+// hot/cold search, re-capture on a low score, and how errors end (or do not end) a session.
+#include <unity.h>
+
+#include "fake_sensor.h"
+#include "sensor_lane.h"
+
+static const uint8_t kGenImg = 0x01, kImg2Tz = 0x02, kSearch = 0x04, kHiSpeed = 0x1B;
+static const uint8_t kOk = 0x00, kNoFinger = 0x02, kNotFound = 0x09, kImageFail = 0x03;
+
+static FakeSensor* sensor;
+static SensorLane* lane;
+
+void setUp() {
+  native::clockMs = 1000;
+  sensor = new FakeSensor();
+  lane = new SensorLane(0, *sensor);
+  lane->begin(0xFFFFFFFF, 200, 80);
+  lane->setPolicy({ 100, 50, 1, true });
+  lane->setHotRange(40);
+}
+
+void tearDown() {
+  delete lane;
+  delete sensor;
+}
+
+// Polls every millisecond until the lane reports something; EV_NONE if nothing within maxMs.
+static SensorLane::Event runUntilEvent(unsigned long maxMs = 5000) {
+  for (unsigned long i = 0; i < maxMs; i++) {
+    SensorLane::Event ev = lane->poll(millis());
+    if (ev != SensorLane::EV_NONE) return ev;
+    native::clockMs++;
+  }
+  return SensorLane::EV_NONE;
+}
+
+// The whole session is scripted up front: the lane sends the next command in the same poll()
+// that reports the previous answer.
+static void expectFinger() {
+  TEST_ASSERT_EQUAL(SensorLane::EV_FINGER, runUntilEvent());
+}
+
+void test_no_finger_paces_genimg() {
+  sensor->answer(kNoFinger);
+  sensor->answer(kNoFinger);
+  for (int i = 0; i < 100; i++) {
+    TEST_ASSERT_EQUAL(SensorLane::EV_NONE, lane->poll(millis()));
+    native::clockMs++;
+  }
+  std::vector<uint8_t> codes = sensor->codes();
+  TEST_ASSERT_EQUAL(2, codes.size());
+  TEST_ASSERT_EQUAL(kGenImg, codes[0]);
+  TEST_ASSERT_GREATER_OR_EQUAL(80, sensor->commands()[1].at - sensor->commands()[0].at);
+  TEST_ASSERT_TRUE(lane->idle());
+}
+
+void test_hot_hit_ends_session_on_first_search() {
+  sensor->answer(kOk);            // GenImg
+  sensor->answer(kOk);            // Img2Tz
+  sensor->answerHit(7, 180);      // hot search
+  expectFinger();
+  TEST_ASSERT_EQUAL(SensorLane::EV_MATCH, runUntilEvent());
+  TEST_ASSERT_TRUE(lane->sessionEnded());
+  TEST_ASSERT_EQUAL(7, lane->fid());
+  TEST_ASSERT_EQUAL(180, lane->score());
+  TEST_ASSERT_EQUAL(SensorLane::OUT_MATCH, lane->lastOutcome());
+
+  std::vector<uint8_t> codes = sensor->codes();
+  uint8_t sequence[] = { kGenImg, kImg2Tz, kHiSpeed };
+  TEST_ASSERT_EQUAL(sizeof(sequence), codes.size());
+  TEST_ASSERT_EQUAL_MEMORY(sequence, codes.data(), sizeof(sequence));
+  const FakeSensor::Command& search = sensor->commands().back();
+  // buffer 1, pages 0..40
+  uint8_t want[] = { 1, 0, 0, 0, 41 };
+  TEST_ASSERT_EQUAL_MEMORY(want, search.args.data(), sizeof(want));
+}
+
+void test_hot_miss_searches_cold_range() {
+  sensor->answer(kOk);            // GenImg
+  sensor->answer(kOk);            // Img2Tz
+  sensor->answer(kNotFound);      // hot
+  sensor->answerHit(150, 120);    // cold
+  expectFinger();
+  TEST_ASSERT_EQUAL(SensorLane::EV_MATCH, runUntilEvent());
+  TEST_ASSERT_EQUAL(150, lane->fid());
+
+  const FakeSensor::Command& cold = sensor->commands().back();
+  TEST_ASSERT_EQUAL(kHiSpeed, cold.code);
+  uint8_t want[] = { 1, 0, 41, 0, 159 };
+  TEST_ASSERT_EQUAL_MEMORY(want, cold.args.data(), sizeof(want));
+  TEST_ASSERT_EQUAL(1, lane->searchStats(SensorLane::SEARCH_HOT).count);
+  TEST_ASSERT_EQUAL(1, lane->searchStats(SensorLane::SEARCH_COLD).hits);
+}
+
+void test_low_score_recaptures_and_keeps_best() {
+  sensor->answer(kOk);            // GenImg
+  sensor->answer(kOk);            // Img2Tz
+  sensor->answerHit(12, 70);      // below acceptScore: capture again
+  sensor->answer(kOk);            // GenImg
+  sensor->answer(kOk);            // Img2Tz
+  sensor->answerHit(12, 90);      // still below, tries used up: best decides
+  expectFinger();
+  TEST_ASSERT_EQUAL(SensorLane::EV_MATCH, runUntilEvent());
+  TEST_ASSERT_EQUAL(90, lane->score());
+  TEST_ASSERT_EQUAL(SensorLane::OUT_MATCH_RECAPTURE, lane->lastOutcome());
+  TEST_ASSERT_EQUAL(1, lane->recaptures());
+  TEST_ASSERT_EQUAL(2, lane->captures());
+}
+
+void test_miss_everywhere_falls_back_to_full_search() {
+  sensor->answer(kOk);            // GenImg
+  sensor->answer(kOk);            // Img2Tz
+  sensor->answer(kNotFound);      // hot
+  sensor->answer(kNotFound);      // cold
+  sensor->answer(kNotFound);      // full
+  expectFinger();
+  TEST_ASSERT_EQUAL(SensorLane::EV_NO_MATCH, runUntilEvent());
+  TEST_ASSERT_EQUAL(kSearch, sensor->commands().back().code);
+  TEST_ASSERT_EQUAL(SensorLane::OUT_MISS, lane->lastOutcome());
+  TEST_ASSERT_TRUE(lane->sessionEnded());
+}
+
+void test_idle_error_does_not_end_a_session() {
+  sensor->answer(kImageFail);     // GenImg error with no finger session open
+  TEST_ASSERT_EQUAL(SensorLane::EV_ERROR, runUntilEvent());
+  TEST_ASSERT_FALSE(lane->sessionEnded());
+  TEST_ASSERT_EQUAL(0, lane->stats(SensorLane::OUT_ERROR).count);
+}
+
+void test_ack_timeout_in_session_ends_it_as_error() {
+  sensor->answer(kOk);            // GenImg
+  expectFinger();                 // Img2Tz is never answered
+  TEST_ASSERT_EQUAL(SensorLane::EV_ERROR, runUntilEvent());
+  TEST_ASSERT_TRUE(lane->sessionEnded());
+  TEST_ASSERT_EQUAL(SensorLane::OUT_ERROR, lane->lastOutcome());
+  TEST_ASSERT_EQUAL(0xFF, lane->lastError());
+}
+
+void test_paused_lane_stays_idle() {
+  lane->setPaused(true);
+  for (int i = 0; i < 500; i++) {
+    lane->poll(millis());
+    native::clockMs++;
+  }
+  TEST_ASSERT_EQUAL(0, sensor->commands().size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_no_finger_paces_genimg);
+  RUN_TEST(test_hot_hit_ends_session_on_first_search);
+  RUN_TEST(test_hot_miss_searches_cold_range);
+  RUN_TEST(test_low_score_recaptures_and_keeps_best);
+  RUN_TEST(test_miss_everywhere_falls_back_to_full_search);
+  RUN_TEST(test_idle_error_does_not_end_a_session);
+  RUN_TEST(test_ack_timeout_in_session_ends_it_as_error);
+  RUN_TEST(test_paused_lane_stays_idle);
+  return UNITY_END();
+}
@@ -0,0 +1,142 @@
+// ServedGossip between two terminals with the transport left out: packets go from one
+// instance's pollSend() straight into the other's receive(), or are dropped to model loss.
+#include <unity.h>
+
+#include "served_gossip.h"
+
+static const uint32_t kDay = 20261018;
+
+static ServedGossip* a;
+static ServedGossip* b;
+static uint8_t buf[ServedGossip::kMaxPacket];
+
+void setUp() {
+  a = new ServedGossip();
+  b = new ServedGossip();
+  a->begin(0xA1, 1);
+  b->begin(0xB2, 1);
+}
+
+void tearDown() {
+  delete a;
+  delete b;
+}
+
+// Sends from a to b whatever is due at `now`; false if nothing was due.
+static bool deliver(unsigned long now, std::vector<int>& fresh) {
+  size_t len = a->pollSend(now, buf, sizeof(buf));
+  if (!len) return false;
+  TEST_ASSERT_TRUE(b->receive(buf, len, kDay, fresh));
+  return true;
+}
+
+void test_local_serve_reaches_peer() {
+  a->noteLocal(kDay, 501, 1000);
+  std::vector<int> fresh;
+  TEST_ASSERT_TRUE(deliver(1000, fresh));
+  TEST_ASSERT_EQUAL(1, fresh.size());
+  TEST_ASSERT_EQUAL(501, fresh[0]);
+  TEST_ASSERT_EQUAL(1, b->remoteToday().size());
+  TEST_ASSERT_EQUAL(1, b->stats().applied);
+}
+
+void test_burst_repeats_on_schedule_then_stops() {
+  a->noteLocal(kDay, 501, 1000);
+  std::vector<unsigned long> sentAt;
+  for (unsigned long t = 1000; t < 3000; t++) {
+    if (a->pollSend(t, buf, sizeof(buf))) sentAt.push_back(t);
+  }
+  // at once, then +20, +30, +50, +400
+  unsigned long want[] = { 1000, 1020, 1050, 1100, 1500 };
+  TEST_ASSERT_EQUAL(5, sentAt.size());
+  for (size_t i = 0; i < sentAt.size(); i++) TEST_ASSERT_EQUAL(want[i], sentAt[i]);
+}
+
+void test_repeats_are_counted_as_duplicates() {
+  a->noteLocal(kDay, 501, 1000);
+  std::vector<int> fresh;
+  for (unsigned long t = 1000; t < 2000; t++) deliver(t, fresh);
+  TEST_ASSERT_EQUAL(1, fresh.size());
+  TEST_ASSERT_EQUAL(5, b->stats().received);
+  TEST_ASSERT_EQUAL(4, b->stats().duplicates);
+}
+
+void test_window_covers_a_lost_packet() {
+  std::vector<int> fresh;
+  a->noteLocal(kDay, 501, 1000);
+  while (a->pollSend(1000, buf, sizeof(buf))) {} // first burst lost
+  for (unsigned long t = 1000; t < 2000; t++) a->pollSend(t, buf, sizeof(buf));
+  a->noteLocal(kDay, 502, 2000);
+  TEST_ASSERT_TRUE(deliver(2000, fresh));
+  TEST_ASSERT_EQUAL(2, fresh.size());
+  TEST_ASSERT_EQUAL(501, fresh[0]);
+  TEST_ASSERT_EQUAL(502, fresh[1]);
+  TEST_ASSERT_EQUAL(0, b->stats().gaps);
+}
+
+void test_gap_beyond_the_window_is_counted() {
+  std::vector<int> fresh;
+  a->noteLocal(kDay, 1, 1000);
+  TEST_ASSERT_TRUE(deliver(1000, fresh));
+  // ten more serves whose packets are all lost; the window only carries the last eight
+  for (int i = 0; i < 10; i++) {
+    a->noteLocal(kDay, 100 + i, 1000);
+    a->pollSend(1000, buf, sizeof(buf));
+  }
+  a->noteLocal(kDay, 200, 1000);
+  TEST_ASSERT_TRUE(deliver(1000, fresh));
+  TEST_ASSERT_EQUAL(1 + ServedGossip::kWindow, fresh.size());
+  TEST_ASSERT_EQUAL(200, fresh.back());
+  TEST_ASSERT_EQUAL(11 - ServedGossip::kWindow, b->stats().gaps);
+}
+
+void test_own_packets_other_days_and_garbage_are_ignored() {
+  std::vector<int> fresh;
+  a->noteLocal(kDay, 501, 1000);
+  size_t len = a->pollSend(1000, buf, sizeof(buf));
+  TEST_ASSERT_FALSE(a->receive(buf, len, kDay, fresh));        // own
+  TEST_ASSERT_FALSE(b->receive(buf, len, kDay + 1, fresh));    // another day
+  TEST_ASSERT_FALSE(b->receive(buf, len - 1, kDay, fresh));    // truncated
+  buf[0] = 'X';
+  TEST_ASSERT_FALSE(b->receive(buf, len, kDay, fresh));        // not ours
+  TEST_ASSERT_EQUAL(0, fresh.size());
+  TEST_ASSERT_EQUAL(3, b->stats().ignored);
+}
+
+void test_restarted_peer_is_heard_again() {
+  std::vector<int> fresh;
+  a->noteLocal(kDay, 501, 1000);
+  deliver(1000, fresh);
+  // the sender reboots: a new boot id and its sequence starts over at 1
+  delete a;
+  a = new ServedGossip();
+  a->begin(0xA1, 2);
+  a->noteLocal(kDay, 777, 5000);
+  TEST_ASSERT_TRUE(deliver(5000, fresh));
+  TEST_ASSERT_EQUAL(2, fresh.size());
+  TEST_ASSERT_EQUAL(777, fresh[1]);
+  TEST_ASSERT_EQUAL(0, b->stats().duplicates);
+}
+
+void test_reset_day_drops_remote_and_unsent() {
+  std::vector<int> fresh;
+  a->noteLocal(kDay, 501, 1000);
+  deliver(1000, fresh);
+  b->resetDay(kDay + 1);
+  TEST_ASSERT_EQUAL(0, b->remoteToday().size());
+  a->resetDay(kDay + 1);
+  TEST_ASSERT_EQUAL(0, a->pollSend(1020, buf, sizeof(buf)));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_local_serve_reaches_peer);
+  RUN_TEST(test_burst_repeats_on_schedule_then_stops);
+  RUN_TEST(test_repeats_are_counted_as_duplicates);
+  RUN_TEST(test_window_covers_a_lost_packet);
+  RUN_TEST(test_gap_beyond_the_window_is_counted);
+  RUN_TEST(test_own_packets_other_days_and_garbage_are_ignored);
+  RUN_TEST(test_restarted_peer_is_heard_again);
+  RUN_TEST(test_reset_day_drops_remote_and_unsent);
+  return UNITY_END();
+}
@@ -0,0 +1,173 @@
+// StaffDirectory built the way the fingerprint map refresh builds it, page by page in fid
+// order, and checked record for record against a std::map: lookups across blocks and heap
+// segments, wide and negative values, forEach order, the builder's input rules, and the
+// StaffMap overlay.
+#include <unity.h>
+
+#include <map>
+#include "staff_directory.h"
+
+typedef std::map<uint32_t, StaffRecord> Reference;
+
+static uint32_t rngState;
+static uint32_t rng() {
+  rngState = rngState * 1664525u + 1013904223u;
+  return rngState >> 8;
+}
+
+void setUp() { rngState = 12345; }
+void tearDown() {}
+
+// `count` records with gaps of 1..maxGap between fids, handed over in pages of `page`.
+static bool build(Reference& ref, StaffDirectory& dir, size_t count, uint32_t maxGap, size_t page) {
+  StaffDirectoryBuilder builder(count);
+  uint32_t fid = 0;
+  for (size_t i = 0; i < count; i++) {
+    fid += 1 + rng() % maxGap;
+    StaffRecord r = { (int)(100000 + rng() % 900000), (int)(rng() % 4) - 1 };
+    ref[fid] = r;
+    if (!builder.add(fid, r)) return false;
+    if ((i + 1) % page == 0) TEST_ASSERT_EQUAL(i + 1, builder.count());
+  }
+  return builder.finish(dir);
+}
+
+static void expectSame(const Reference& ref, const StaffDirectory& dir) {
+  TEST_ASSERT_EQUAL(ref.size(), dir.size());
+  StaffRecord got;
+  for (const auto& kv : ref) {
+    TEST_ASSERT_TRUE(dir.find(kv.first, got));
+    TEST_ASSERT_EQUAL(kv.second.staffid, got.staffid);
+    TEST_ASSERT_EQUAL(kv.second.tag, got.tag);
+  }
+}
+
+void test_small_directory_round_trips() {
+  Reference ref;
+  StaffDirectory dir;
+  TEST_ASSERT_TRUE(build(ref, dir, 10, 3, 4));
+  expectSame(ref, dir);
+  StaffRecord got;
+  TEST_ASSERT_FALSE(dir.find(0, got));
+  TEST_ASSERT_FALSE(dir.find(ref.rbegin()->first + 1, got));
+}
+
+void test_many_pages_span_blocks_and_segments() {
+  Reference ref;
+  StaffDirectory dir;
+  TEST_ASSERT_TRUE(build(ref, dir, 20000, 5, 500));
+  expectSame(ref, dir);
+  TEST_ASSERT_GREATER_THAN(StaffDirectory::kSegmentBytes, dir.encodedBytes());
+  TEST_ASSERT_GREATER_THAN(StaffDirectory::kSegmentBytes, dir.bytes());
+  // the point of the format: well under the 12 bytes of a plain {fid, staffid, tag} record
+  TEST_ASSERT_LESS_THAN(6 * dir.size(), dir.encodedBytes());
+
+  // fids in the gaps are absent
+  StaffRecord got;
+  uint32_t prev = 0;
+  size_t misses = 0;
+  for (const auto& kv : ref) {
+    for (uint32_t f = prev + 1; f < kv.first; f++) misses += !dir.find(f, got);
+    prev = kv.first;
+  }
+  TEST_ASSERT_GREATER_THAN(0, misses);
+}
+
+// Offsets past INT32_MAX within one block: decoded with the same wrap-around as encoded.
+void test_wide_values_and_big_gaps() {
+  StaffDirectoryBuilder builder;
+  Reference ref;
+  ref[1] = { 1, -1 };
+  ref[2] = { 2147483647, 2147483647 };
+  ref[70000] = { -5, -2147483647 };
+  ref[4000000000u] = { 42, 0 };
+  for (const auto& kv : ref) TEST_ASSERT_TRUE(builder.add(kv.first, kv.second));
+  StaffDirectory dir;
+  TEST_ASSERT_TRUE(builder.finish(dir));
+  expectSame(ref, dir);
+}
+
+void test_for_each_visits_in_fid_order() {
+  Reference ref;
+  StaffDirectory dir;
+  TEST_ASSERT_TRUE(build(ref, dir, 1000, 7, 100));
+  auto it = ref.begin();
+  size_t n = 0;
+  dir.forEach([&](uint32_t fid, const StaffRecord& r) {
+    TEST_ASSERT_TRUE(it != ref.end());
+    TEST_ASSERT_EQUAL(it->first, fid);
+    TEST_ASSERT_EQUAL(it->second.staffid, r.staffid);
+    ++it;
+    n++;
+  });
+  TEST_ASSERT_EQUAL(ref.size(), n);
+}
+
+void test_repeated_fid_replaces_and_out_of_order_fails() {
+  StaffDirectoryBuilder builder;
+  TEST_ASSERT_TRUE(builder.add(5, { 50, 1 }));
+  TEST_ASSERT_TRUE(builder.add(5, { 51, 2 }));
+  TEST_ASSERT_TRUE(builder.add(9, { 90, 0 }));
+  TEST_ASSERT_EQUAL(2, builder.count());
+  TEST_ASSERT_FALSE(builder.add(7, { 70, 0 }));
+  TEST_ASSERT_TRUE(builder.failed());
+  TEST_ASSERT_FALSE(builder.add(10, { 100, 0 }));
+  StaffDirectory dir;
+  TEST_ASSERT_FALSE(builder.finish(dir));
+}
+
+void test_empty_directory() {
+  StaffDirectoryBuilder builder;
+  StaffDirectory dir;
+  TEST_ASSERT_TRUE(builder.finish(dir));
+  StaffRecord got;
+  TEST_ASSERT_EQUAL(0, dir.size());
+  TEST_ASSERT_FALSE(dir.find(1, got));
+}
+
+void test_staff_map_overlay() {
+  Reference ref;
+  StaffDirectory dir;
+  TEST_ASSERT_TRUE(build(ref, dir, 100, 4, 50));
+  uint32_t first = ref.begin()->first, last = ref.rbegin()->first;
+  StaffMap map;
+  map.replace(std::move(dir));
+
+  StaffRecord got;
+  map.set(first, { 7, 7 });          // change a record
+  map.erase(std::next(ref.begin())->first);
+  map.set(last + 10, { 8, 8 });      // a new enrollment past the end
+  TEST_ASSERT_TRUE(map.find(first, got));
+  TEST_ASSERT_EQUAL(7, got.staffid);
+  TEST_ASSERT_FALSE(map.contains(std::next(ref.begin())->first));
+  TEST_ASSERT_TRUE(map.contains(last + 10));
+  TEST_ASSERT_EQUAL(ref.size(), map.size());
+
+  // forEach merges the changes in fid order
+  std::vector<uint32_t> fids;
+  map.forEach([&](uint32_t fid, const StaffRecord&) { fids.push_back(fid); });
+  TEST_ASSERT_EQUAL(ref.size(), fids.size());
+  for (size_t i = 1; i < fids.size(); i++) TEST_ASSERT_GREATER_THAN(fids[i - 1], fids[i]);
+  TEST_ASSERT_EQUAL(last + 10, fids.back());
+
+  // the next sync's directory replaces the changes
+  StaffDirectory next;
+  StaffDirectoryBuilder builder;
+  builder.add(first, { 9, 9 });
+  builder.finish(next);
+  map.replace(std::move(next));
+  TEST_ASSERT_EQUAL(1, map.size());
+  TEST_ASSERT_FALSE(map.contains(last + 10));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_small_directory_round_trips);
+  RUN_TEST(test_many_pages_span_blocks_and_segments);
+  RUN_TEST(test_wide_values_and_big_gaps);
+  RUN_TEST(test_for_each_visits_in_fid_order);
+  RUN_TEST(test_repeated_fid_replaces_and_out_of_order_fails);
+  RUN_TEST(test_empty_directory);
+  RUN_TEST(test_staff_map_overlay);
+  return UNITY_END();
+}
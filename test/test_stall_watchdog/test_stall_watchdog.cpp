@@ -0,0 +1,130 @@
+// StallWatchdog on the fake clock: the scan SLO hour, a stage that overruns its budget being
+// flagged by the checker and closed by the next stage(), the sleep exemption, and the RTC ring
+// surviving a watchdog reset but not a power-on.
+#include <unity.h>
+
+#include <esp_system.h>
+#include <esp_timer.h>
+#include "stall_watchdog.h"
+
+static StallWatchdog* wd;
+static int8_t net;
+
+static bool logged(const char* text) { return native::serialLog.find(text) != std::string::npos; }
+
+// A fresh boot: new instance, `reason` as the cause of the last reset.
+static void boot(esp_reset_reason_t reason) {
+  delete wd;
+  native::resetReason = reason;
+  native::serialLog.clear();
+  wd = new StallWatchdog();
+  net = wd->addTask("network", 1000);
+  wd->begin(250, 1500);
+}
+
+void setUp() {
+  native::clockMs = 10000;
+  wd = nullptr;
+  boot(ESP_RST_POWERON);
+}
+
+void tearDown() {
+  delete wd;
+  wd = nullptr;
+}
+
+void test_slo_hour_counts_and_resets() {
+  wd->noteAnswer(400);
+  wd->noteAnswer(1500);
+  wd->noteAnswer(2200);
+  StallWatchdog::SloHour h = wd->takeHour();
+  TEST_ASSERT_EQUAL(3, h.answered);
+  TEST_ASSERT_EQUAL(2, h.withinTarget);
+  TEST_ASSERT_EQUAL(2200, h.worstMs);
+  TEST_ASSERT_EQUAL(0, wd->takeHour().answered);
+}
+
+void test_timer_runs_the_checker() {
+  TEST_ASSERT_EQUAL(250000, native::timerPeriodUs);
+  wd->stage(net, "fetch staff");
+  native::clockMs += 1200;
+  native::fireTimer();
+  TEST_ASSERT_EQUAL(1, wd->takeHour().stalls);
+}
+
+void test_overrun_is_flagged_then_closed() {
+  wd->stage(net, "fetch staff");
+  native::clockMs += 900;
+  wd->check(millis());
+  wd->report();
+  TEST_ASSERT_FALSE(logged("Stall:"));
+
+  native::clockMs += 300;
+  wd->check(millis());
+  native::clockMs += 500;
+  wd->check(millis()); // still stuck: the same record grows, no second stall
+  wd->report();
+  TEST_ASSERT_TRUE(logged("Stall: network stuck in 'fetch staff' 1700 ms (budget 1000)"));
+  TEST_ASSERT_EQUAL(1, wd->takeHour().stalls);
+
+  native::clockMs += 100;
+  wd->stage(net, "idle");
+  native::serialLog.clear();
+  wd->report();
+  TEST_ASSERT_TRUE(logged("Stall: network left 'fetch staff' after 1800 ms"));
+  native::serialLog.clear();
+  wd->report();
+  TEST_ASSERT_FALSE(logged("Stall:"));
+}
+
+void test_sleep_is_not_a_stall() {
+  wd->sleep(net);
+  native::clockMs += 60000;
+  wd->check(millis());
+  TEST_ASSERT_EQUAL(0, wd->takeHour().stalls);
+  wd->stage(net, "reconnect"); // watched again from here
+  native::clockMs += 1001;
+  wd->check(millis());
+  TEST_ASSERT_EQUAL(1, wd->takeHour().stalls);
+}
+
+void test_stall_survives_watchdog_reset() {
+  wd->stage(net, "tls handshake");
+  native::clockMs += 4000;
+  wd->check(millis());
+  boot(ESP_RST_TASK_WDT);
+  TEST_ASSERT_TRUE(logged("Stall log: 1 stalls since power-on"));
+  TEST_ASSERT_TRUE(logged("boot -1: network in 'tls handshake' until reset, 4000 ms"));
+  // already shown at boot: not repeated by report()
+  native::serialLog.clear();
+  wd->report();
+  TEST_ASSERT_FALSE(logged("Stall:"));
+}
+
+void test_power_on_clears_the_ring() {
+  wd->stage(net, "tls handshake");
+  native::clockMs += 4000;
+  wd->check(millis());
+  boot(ESP_RST_POWERON);
+  TEST_ASSERT_FALSE(logged("Stall log"));
+}
+
+void test_unknown_task_id_is_ignored() {
+  StallWatchdog full;
+  for (uint8_t i = 0; i < StallWatchdog::kTasks; i++) TEST_ASSERT_EQUAL(i, full.addTask("t", 100));
+  TEST_ASSERT_EQUAL(-1, full.addTask("extra", 100));
+  full.stage(-1, "nothing");
+  full.sleep(-1);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_slo_hour_counts_and_resets);
+  RUN_TEST(test_timer_runs_the_checker);
+  RUN_TEST(test_overrun_is_flagged_then_closed);
+  RUN_TEST(test_sleep_is_not_a_stall);
+  RUN_TEST(test_stall_survives_watchdog_reset);
+  RUN_TEST(test_power_on_clears_the_ring);
+  RUN_TEST(test_unknown_task_id_is_ignored);
+  return UNITY_END();
+}